@@ -0,0 +1,362 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <fmt/format.h>
+#include <glad/gles2.h>
+#include <wnlrenderer/batch.h>
+#include <wnlrenderer/convert.h>
+#include <wnlrenderer/renderer.h>
+#include <window.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "frag.h"
+#include "vert.h"
+
+// Headless benchmarks for the renderer. Every result is one JSON object per
+// line on stdout, so runs of two versions can be diffed or fed to a script:
+//
+//   wnlrenderer_bench [--quick]
+//
+// --quick cuts the iteration counts for smoke-testing the harness itself.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int iterations = 200;
+    int frames     = 600;
+};
+
+auto seconds_since(Clock::time_point start) -> double {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+auto percentile(std::vector<double> samples, double fraction) -> double {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    auto index = static_cast<size_t>(fraction *
+                                      static_cast<double>(samples.size() - 1));
+    std::ranges::nth_element(samples, samples.begin() +
+                                          static_cast<ptrdiff_t>(index));
+    return samples[index];
+}
+
+auto source_name(renderer::SourceFormat source) -> char const* {
+    switch (source) {
+        case renderer::SourceFormat::YUYV:
+            return "YUYV";
+        case renderer::SourceFormat::UYVY:
+            return "UYVY";
+        default:
+            return "P010";
+    }
+}
+
+auto simd_name(renderer::SimdLevel level) -> char const* {
+    switch (level) {
+        case renderer::SimdLevel::sse2:
+            return "sse2";
+        case renderer::SimdLevel::avx2:
+            return "avx2";
+        case renderer::SimdLevel::neon:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
+
+auto format_name(int format) -> char const* {
+    switch (format) {
+        case GL_RGBA:
+            return "RGBA";
+        case GL_RGB:
+            return "RGB";
+        default:
+            return "RED";
+    }
+}
+
+// Texture::copy_data() throughput, through the staging ring and into the
+// texture. Timed up to a glFinish(), so the GPU side of the copy counts too.
+template <int format>
+auto bench_copy_data(Options const& options) -> void {
+    constexpr int bytes_per_pixel = renderer::bytes_per_pixel_of(format);
+    constexpr std::array<std::array<int, 2>, 3> sizes{
+        {{640, 360}, {1280, 720}, {1920, 1080}}};
+
+    for (auto [width, height] : sizes) {
+        // Packed rows, and rows padded by a pixel, which makes the pitch odd
+        // for the 1- and 3-byte formats.
+        for (auto pitch : {width * bytes_per_pixel,
+                           (width + 1) * bytes_per_pixel}) {
+            renderer::Texture<format> texture{width, height};
+            std::vector<std::byte> data(static_cast<size_t>(pitch) *
+                                        static_cast<size_t>(height));
+            std::ranges::fill(data, std::byte{0x7F});
+
+            texture.copy_data(data, pitch);  // warm-up
+            glFinish();
+            auto start = Clock::now();
+            for (int i = 0; i < options.iterations; i++) {
+                texture.copy_data(data, pitch);
+            }
+            glFinish();
+            auto elapsed = seconds_since(start);
+
+            auto bytes = static_cast<double>(data.size()) *
+                         static_cast<double>(options.iterations);
+            fmt::println(R"({{"benchmark":"copy_data","format":"{}",)"
+                         R"("width":{},"height":{},"pitch":{},)"
+                         R"("iterations":{},"mb_per_s":{:.1f}}})",
+                         format_name(format), width, height, pitch,
+                         options.iterations, bytes / elapsed / 1e6);
+        }
+    }
+}
+
+// ColorConverter on a 1080p frame, from scalar up to the widest kernels the
+// CPU runs, on the calling thread alone and split across the default pool.
+// Converts straight into the staging buffer and commits, as a stream would.
+auto bench_convert(Options const& options,
+                   renderer::SourceFormat source,
+                   renderer::YuvLayout layout) -> void {
+    constexpr int width  = 1920;
+    constexpr int height = 1080;
+    auto rows = source == renderer::SourceFormat::P010 ? height + height / 2
+                                                       : height;
+    std::vector<std::byte> data(static_cast<size_t>(width) * 2 *
+                                static_cast<size_t>(rows));
+    std::ranges::fill(data, std::byte{0x7F});
+    renderer::YuvTexture texture{layout, width, height};
+
+    auto best = renderer::detect_simd_level();
+    for (auto level : {renderer::SimdLevel::scalar, best}) {
+        for (auto threads : {0U, renderer::ConversionPool::default_threads()}) {
+            renderer::ColorConverter converter{level, threads};
+            auto convert = [&] {
+                auto frame = texture.begin_upload();
+                converter.convert(source, data, 0, texture, frame);
+                texture.commit(frame);
+            };
+            convert();  // warm-up
+            glFinish();
+            auto start = Clock::now();
+            for (int i = 0; i < options.iterations; i++) {
+                convert();
+            }
+            glFinish();
+            auto elapsed = seconds_since(start);
+
+            fmt::println(R"({{"benchmark":"convert","source":"{}",)"
+                         R"("layout":"{}","simd":"{}","threads":{},)"
+                         R"("iterations":{},"frame_ms":{:.3f}}})",
+                         source_name(source),
+                         layout == renderer::YuvLayout::I420 ? "I420" : "NV12",
+                         simd_name(level), threads, options.iterations,
+                         elapsed * 1e3 / options.iterations);
+        }
+        if (best == renderer::SimdLevel::scalar) {
+            break;
+        }
+    }
+}
+
+template <typename Build>
+auto time_build(char const* name, Build build) -> void {
+    constexpr int runs = 5;
+    std::vector<double> samples;
+    for (int i = 0; i < runs; i++) {
+        auto start = Clock::now();
+        auto program = build();
+        glFinish();
+        samples.push_back(seconds_since(start) * 1e3);
+    }
+    fmt::println(R"({{"benchmark":"shader_build","program":"{}",)"
+                 R"("runs":{},"first_ms":{:.3f},"p50_ms":{:.3f}}})",
+                 name, runs, samples.front(), percentile(samples, 0.5));
+}
+
+// Compile and link time without a binary cache. Drivers may keep their own
+// cache, so later runs can be much faster than the first.
+auto bench_shader_build() -> void {
+    auto build = [](char const* vertex, char const* fragment) {
+        return [=] {
+            return renderer::ShaderProgram{vertex, fragment};
+        };
+    };
+    time_build("texture", build(vertex_shader, fragment_shader));
+    time_build("yuv", build(vertex_shader, yuv_fragment_shader));
+    time_build("block", build(block_vertex_shader, texture_fragment_shader));
+}
+
+// Draw throughput and frame time percentiles for `count` renderables drawn
+// one by one, each frame finished with glFinish().
+auto bench_draws(Options const& options,
+                 window::Window& window,
+                 int count) -> void {
+    renderer::ShaderProgram program{vertex_shader, fragment_shader};
+    auto mesh    = std::make_shared<renderer::Mesh>(renderer::QuadMesh2D());
+    auto texture = std::make_shared<renderer::Texture<GL_RGBA>>(64, 64);
+
+    auto viewport = window.get_viewport();
+    std::vector<renderer::Renderable<GL_RGBA>> renderables;
+    renderables.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        auto& renderable = renderables.emplace_back(mesh, texture);
+        renderable.set_scale({16.0F, 16.0F});
+        renderable.set_position(
+            renderer::PositionTopLeft,
+            {static_cast<float>((i * 17) % viewport.size.width),
+             static_cast<float>((i * 31) % viewport.size.height), 0.0F});
+    }
+
+    program.use();
+    program.set<"u_Projection">(viewport.projection);
+    std::vector<double> frame_times;
+    frame_times.reserve(static_cast<size_t>(options.frames));
+    auto start = Clock::now();
+    for (int frame = 0; frame < options.frames; frame++) {
+        auto frame_start = Clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (auto& renderable : renderables) {
+            renderable.draw(program);
+        }
+        glFinish();
+        frame_times.push_back(seconds_since(frame_start) * 1e3);
+    }
+    auto elapsed = seconds_since(start);
+
+    auto draws = static_cast<double>(count) *
+                 static_cast<double>(options.frames);
+    fmt::println(R"({{"benchmark":"draws","renderables":{},"frames":{},)"
+                 R"("draws_per_s":{:.0f},"frame_p50_ms":{:.3f},)"
+                 R"("frame_p99_ms":{:.3f}}})",
+                 count, options.frames, draws / elapsed,
+                 percentile(frame_times, 0.5), percentile(frame_times, 0.99));
+}
+
+// A grid of tiles that each stream new contents every frame, drawn through
+// a BatchRenderer with an opaque cover over the left half. With `cull`, the
+// tiles cull() finds hidden skip their upload for the frame, as the
+// BatchRenderer docs describe; without, every tile is uploaded.
+auto bench_culled_uploads(Options const& options,
+                          window::Window& window,
+                          bool cull) -> void {
+    constexpr int columns = 8;
+    constexpr int rows    = 8;
+    constexpr int tile_px = 128;
+
+    auto viewport          = window.get_viewport();
+    auto const& projection = viewport.projection;
+    auto tile_width        = static_cast<float>(viewport.size.width) / columns;
+    auto tile_height       = static_cast<float>(viewport.size.height) / rows;
+
+    renderer::ShaderProgram program{instanced_vertex_shader, fragment_shader};
+    auto mesh = std::make_shared<renderer::Mesh>(renderer::QuadMesh2D());
+    std::vector<std::shared_ptr<renderer::Texture<GL_RGBA>>> textures;
+    std::vector<renderer::Renderable<GL_RGBA>> tiles;
+    tiles.reserve(columns * rows);
+    for (int i = 0; i < columns * rows; i++) {
+        auto& texture = textures.emplace_back(
+            std::make_shared<renderer::Texture<GL_RGBA>>(tile_px, tile_px));
+        auto& tile = tiles.emplace_back(mesh, texture);
+        tile.set_scale({tile_width, tile_height});
+        tile.set_position(renderer::PositionTopLeft,
+                          {static_cast<float>(i % columns) * tile_width,
+                           static_cast<float>(i / columns) * tile_height,
+                           0.0F});
+    }
+    renderer::Renderable cover{
+        mesh, std::make_shared<renderer::Texture<GL_RGBA>>(tile_px, tile_px)};
+    cover.set_opaque(true);
+    cover.set_scale({static_cast<float>(viewport.size.width) / 2.0F,
+                     static_cast<float>(viewport.size.height)});
+    cover.set_position(renderer::PositionTopLeft, {0.0F, 0.0F, 1.0F});
+
+    std::vector<std::byte> pixels(static_cast<size_t>(tile_px) * tile_px * 4);
+    std::ranges::fill(pixels, std::byte{0x7F});
+    renderer::BatchRenderer batch;
+    size_t uploads = 0;
+    std::vector<double> frame_times;
+    frame_times.reserve(static_cast<size_t>(options.frames));
+    for (int frame = 0; frame < options.frames; frame++) {
+        auto frame_start = Clock::now();
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (auto& tile : tiles) {
+            batch.submit(program, tile);
+        }
+        batch.submit(program, cover);
+        if (cull) {
+            batch.cull(projection);
+        }
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (!cull || batch.is_visible(tiles[i])) {
+                textures[i]->copy_data(pixels, 0);
+                uploads++;
+            }
+        }
+        batch.flush(projection);
+        glFinish();
+        frame_times.push_back(seconds_since(frame_start) * 1e3);
+    }
+
+    fmt::println(R"({{"benchmark":"culled_uploads","cull":{},"tiles":{},)"
+                 R"("frames":{},"uploads_per_frame":{:.1f},)"
+                 R"("frame_p50_ms":{:.3f},"frame_p99_ms":{:.3f}}})",
+                 cull, tiles.size(), options.frames,
+                 static_cast<double>(uploads) / options.frames,
+                 percentile(frame_times, 0.5), percentile(frame_times, 0.99));
+}
+
+};  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} == "--quick") {
+            options = {.iterations = 10, .frames = 30};
+        } else {
+            fmt::println(stderr, "usage: {} [--quick]", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    window::GLFWContext _{};
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window::Window window{{.width = 1280, .height = 720}, "wnlrenderer_bench"};
+    auto context = window.get_context();
+    gladLoadGLES2(glfwGetProcAddress);
+    glfwSwapInterval(0);
+
+    fmt::println(R"({{"benchmark":"context","renderer":"{}","version":"{}"}})",
+                 renderer::detail::gl_string(GL_RENDERER),
+                 renderer::detail::gl_string(GL_VERSION));
+
+    bench_copy_data<GL_RGBA>(options);
+    bench_copy_data<GL_RGB>(options);
+    bench_copy_data<GL_RED>(options);
+    bench_convert(options, renderer::SourceFormat::YUYV,
+                  renderer::YuvLayout::I420);
+    bench_convert(options, renderer::SourceFormat::YUYV,
+                  renderer::YuvLayout::NV12);
+    bench_convert(options, renderer::SourceFormat::P010,
+                  renderer::YuvLayout::NV12);
+    bench_shader_build();
+    for (auto count : {1, 100, 1000}) {
+        bench_draws(options, window, count);
+    }
+    bench_culled_uploads(options, window, false);
+    bench_culled_uploads(options, window, true);
+    return EXIT_SUCCESS;
+}
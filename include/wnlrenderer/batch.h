@@ -0,0 +1,389 @@
+#pragma once
+
+#include <wnlrenderer/registry.h>
+#include <wnlrenderer/renderer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace renderer {
+
+// Collects renderables, or sprites of a ResourceRegistry, for a frame and
+// draws every run that shares a program, mesh and textures with one
+// glDrawElementsInstanced. The per-instance transform is fed to
+// `a_transform` and the texture array layer to `a_layer` (see
+// renderer::attribute), so programs used here need an instanced vertex
+// shader. Renderables sampling layers of one TextureArray share its texture
+// name and therefore land in the same draw.
+//
+// Submitted renderables are referenced, not copied, and must outlive flush().
+// Sprites are submitted by handle, resolved through their registry and
+// copied; only the handle is kept, for is_visible().
+// Renderables sharing a z are reordered to batch only where they do not
+// overlap, taking them for quads as cull() does; overlapping ones are drawn
+// in the order they were submitted.
+//
+// With an ortho projection, flush() leaves out renderables that are off
+// screen or fully covered by an opaque one at a higher z. Calling cull()
+// first tells which those are before anything is uploaded, so hidden streams
+// can skip their texture uploads for the frame:
+//
+//   batch.submit(program, tile); ...
+//   batch.cull(projection);
+//   if (batch.is_visible(tile)) { tile_texture->copy_data(...); }
+//   batch.flush(projection);
+struct BatchRenderer {
+    BatchRenderer() {
+        for (size_t column = 0; column < 4; column++) {
+            instance_layout_.push<float>(
+                4, offsetof(Instance, transform) + column * sizeof(glm::vec4));
+        }
+        instance_layout_.push<float>(1, offsetof(Instance, layer));
+        instance_layout_.set_stride(sizeof(Instance));
+    }
+
+    template <int format>
+    auto submit(ShaderProgram& shader, Renderable<format>& renderable)
+        -> void {
+        submit(shader, renderable, renderable.get_transform());
+    }
+
+    // Draws `renderable`'s mesh and textures with `transform` instead of its
+    // own, e.g. one kept in a TransformStore.
+    template <int format>
+    auto submit(ShaderProgram& shader,
+                Renderable<format> const& renderable,
+                glm::mat4 const& transform) -> void {
+        entries_.push_back({
+            .depth          = transform[3][2],
+            .program        = shader.get_id(),
+            .mesh           = renderable.get_mesh().get(),
+            .textures       = renderable.get_texture_ids(),
+            .texture_target = renderable.get_texture_target(),
+            .shader         = &shader,
+            .source         = &renderable,
+            .id             = {&renderable, 0},
+            .opaque         = renderable.is_opaque(),
+            .visible        = true,
+            .bind           = [](void const* source) {
+                static_cast<Renderable<format> const*>(source)->bind_textures();
+            },
+            .instance       = {transform, renderable.get_layer()},
+        });
+    }
+
+    // Throws on a stale handle.
+    auto submit(ShaderProgram& shader,
+                ResourceRegistry const& registry,
+                SpriteHandle handle) -> void {
+        auto const& sprite  = registry.get_sprite(handle);
+        auto const& binding = registry.get_binding(sprite.texture);
+        entries_.push_back({
+            .depth          = sprite.position.z,
+            .program        = shader.get_id(),
+            .mesh           = &registry.get_mesh(sprite.mesh),
+            .textures       = binding.textures,
+            .texture_target = binding.target,
+            .shader         = &shader,
+            .source         = nullptr,
+            .id             = {&registry, handle.value},
+            .opaque         = sprite.opaque,
+            .visible        = true,
+            .bind           = nullptr,
+            .instance = {compose_2d(sprite.position, sprite.scale),
+                         sprite.layer},
+        });
+    }
+
+    // Sorts what was submitted since the last flush and works out what
+    // `projection` leaves visible, assuming quads spanning -0.5..0.5 as
+    // DamageTracker does. Only renderables with an axis-aligned transform
+    // occlude others. Does not touch GL.
+    auto cull(glm::mat4 const& projection) -> void {
+        sort();
+        occluders_.clear();
+        visible_sources_.clear();
+        culled_ = 0;
+
+        // Top down, so that each entry is checked against every opaque one
+        // above it; those sharing its z are added only after the whole run.
+        for (size_t end = entries_.size(); end > 0;) {
+            auto depth = entries_[end - 1].depth;
+            auto begin = end - 1;
+            while (begin > 0 && entries_[begin - 1].depth == depth) {
+                begin--;
+            }
+            auto above = occluders_.size();
+            for (auto i = begin; i < end; i++) {
+                auto& entry   = entries_[i];
+                auto mvp      = projection * entry.instance.transform;
+                auto bounds   = clip_bounds_of(mvp);
+                entry.visible = !is_off_screen(bounds) &&
+                                !is_covered(bounds, above);
+                if (!entry.visible) {
+                    culled_++;
+                    continue;
+                }
+                visible_sources_.push_back(entry.id);
+                if (entry.opaque && mvp[0][1] == 0.0F && mvp[1][0] == 0.0F) {
+                    occluders_.push_back(bounds);
+                }
+            }
+            end = begin;
+        }
+        std::ranges::sort(visible_sources_);
+        culled_projection_ = projection;
+        culled_size_       = entries_.size();
+    }
+
+    // Whether cull() found any submission of `renderable` left to draw.
+    template <int format>
+    auto is_visible(Renderable<format> const& renderable) const -> bool {
+        return is_visible_source({&renderable, 0});
+    }
+
+    auto is_visible(ResourceRegistry const& registry,
+                    SpriteHandle sprite) const -> bool {
+        return is_visible_source({&registry, sprite.value});
+    }
+
+    // Sorts and draws everything submitted since the last flush, setting
+    // u_Projection on each program used. Culls with `projection` unless
+    // cull() already did.
+    auto flush(glm::mat4 const& projection) -> void {
+        if (!is_culled() || culled_projection_ != projection) {
+            cull(projection);
+        }
+        flush(&projection);
+    }
+
+    // As above, for programs that read the projection from a bound
+    // FrameUniforms block. Culls only if cull() was called, again with its
+    // projection if more was submitted since.
+    auto flush() -> void {
+        flush(nullptr);
+    }
+
+    // Instanced draws issued by the most recent flush().
+    auto get_draw_calls() const noexcept -> size_t {
+        return draw_calls_;
+    }
+
+    // Submissions the most recent flush() left out as hidden.
+    auto get_culled() const noexcept -> size_t {
+        return culled_;
+    }
+
+private:
+    // Corners of a quad's screen area in clip space.
+    struct Bounds {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    static auto clip_bounds_of(glm::mat4 const& mvp) -> Bounds {
+        Bounds bounds{glm::vec2{std::numeric_limits<float>::max()},
+                      glm::vec2{std::numeric_limits<float>::lowest()}};
+        for (auto corner : {glm::vec2{-0.5F, -0.5F}, glm::vec2{0.5F, -0.5F},
+                            glm::vec2{-0.5F, 0.5F}, glm::vec2{0.5F, 0.5F}}) {
+            auto point = mvp * glm::vec4{corner.x, corner.y, 0.0F, 1.0F};
+            bounds.min = glm::min(bounds.min, glm::vec2{point.x, point.y});
+            bounds.max = glm::max(bounds.max, glm::vec2{point.x, point.y});
+        }
+        return bounds;
+    }
+
+    static auto is_off_screen(Bounds const& bounds) -> bool {
+        return bounds.max.x <= -1.0F || bounds.min.x >= 1.0F ||
+               bounds.max.y <= -1.0F || bounds.min.y >= 1.0F;
+    }
+
+    // Against the occluders found before index `count`, i.e. at higher z.
+    auto is_covered(Bounds const& bounds, size_t count) const -> bool {
+        return std::any_of(occluders_.begin(),
+                           occluders_.begin() + static_cast<ptrdiff_t>(count),
+                           [&](Bounds const& occluder) {
+                               return occluder.min.x <= bounds.min.x &&
+                                      occluder.min.y <= bounds.min.y &&
+                                      occluder.max.x >= bounds.max.x &&
+                                      occluder.max.y >= bounds.max.y;
+                           });
+    }
+
+    auto is_visible_source(SourceId const& source) const -> bool {
+        return !is_culled() ||
+               std::ranges::binary_search(visible_sources_, source);
+    }
+
+    // Whether cull() has seen every submission so far.
+    auto is_culled() const noexcept -> bool {
+        return culled_size_ != 0 && culled_size_ == entries_.size();
+    }
+
+    auto sort() -> void {
+        std::ranges::stable_sort(entries_, {}, &Entry::depth);
+        for (size_t begin = 0; begin < entries_.size();) {
+            auto end = begin + 1;
+            while (end < entries_.size() &&
+                   entries_[end].depth == entries_[begin].depth) {
+                end++;
+            }
+            assign_passes(begin, end);
+            begin = end;
+        }
+        std::ranges::stable_sort(entries_, {}, [](Entry const& entry) {
+            return std::tie(entry.depth, entry.pass, entry.program, entry.mesh,
+                            entry.textures);
+        });
+    }
+
+    // Puts each entry of the run [begin, end), all at one z, in a pass after
+    // every earlier-submitted one it overlaps and cannot share a draw with,
+    // so sorting by pass before the batch key keeps painter's order where it
+    // shows. Bounds are taken before projection; an ortho one keeps what
+    // overlaps.
+    auto assign_passes(size_t begin, size_t end) -> void {
+        auto run = std::span{entries_}.subspan(begin, end - begin);
+        for (auto& entry : run) {
+            entry.pass = 0;
+        }
+        if (std::ranges::all_of(run, [&](Entry const& entry) {
+                return same_batch(entry, run.front());
+            })) {
+            return;
+        }
+        pass_bounds_.clear();
+        for (size_t i = 0; i < run.size(); i++) {
+            pass_bounds_.push_back(clip_bounds_of(run[i].instance.transform));
+            for (size_t j = 0; j < i; j++) {
+                if (overlaps(pass_bounds_[i], pass_bounds_[j])) {
+                    auto after  = same_batch(run[i], run[j]) ? 0U : 1U;
+                    run[i].pass = std::max(run[i].pass, run[j].pass + after);
+                }
+            }
+        }
+    }
+
+    // Sharing an edge is not overlapping, so tiles laid edge to edge batch.
+    static auto overlaps(Bounds const& lhs, Bounds const& rhs) -> bool {
+        return lhs.min.x < rhs.max.x && rhs.min.x < lhs.max.x &&
+               lhs.min.y < rhs.max.y && rhs.min.y < lhs.max.y;
+    }
+
+    auto flush(glm::mat4 const* projection) -> void {
+        draw_calls_ = 0;
+        if (culled_size_ != 0 && !is_culled()) {
+            // Submitted after cull(), which has to see them too.
+            cull(culled_projection_);
+        } else if (!is_culled()) {
+            culled_ = 0;
+            sort();
+        }
+        culled_size_ = 0;
+        std::erase_if(entries_,
+                      [](Entry const& entry) { return !entry.visible; });
+        if (entries_.empty()) {
+            return;
+        }
+
+        instances_.clear();
+        instances_.reserve(entries_.size());
+        for (auto const& entry : entries_) {
+            instances_.push_back(entry.instance);
+        }
+        auto instance_bytes = std::as_bytes(std::span{instances_});
+        instance_ring_.begin_frame();
+        instance_ring_.reserve(instance_bytes.size());
+        auto instance_offset = instance_ring_.stream(instance_bytes);
+
+        GLuint current_program = 0;
+        for (size_t first = 0; first < entries_.size();) {
+            auto const& head = entries_[first];
+            auto last        = first + 1;
+            while (last < entries_.size() && same_batch(head, entries_[last])) {
+                last++;
+            }
+
+            if (head.program != current_program) {
+                head.shader->use();
+                if (projection != nullptr) {
+                    head.shader->set<"u_Projection">(*projection);
+                }
+                current_program = head.program;
+            }
+            if (head.bind != nullptr) {
+                head.bind(head.source);
+            } else {
+                bind_names(head);
+            }
+            head.mesh->draw_instanced(
+                instance_ring_.get_id(), instance_layout_,
+                instance_offset + (first * sizeof(Instance)),
+                static_cast<GLsizei>(last - first));
+            draw_calls_++;
+
+            first = last;
+        }
+
+        instance_ring_.end_frame();
+        entries_.clear();
+    }
+
+    struct Instance {
+        glm::mat4 transform;
+        float layer;
+    };
+
+    struct Entry {
+        float depth;
+        GLuint program;
+        Mesh* mesh;
+        std::array<GLuint, 3> textures;
+        GLenum texture_target;
+        ShaderProgram* shader;
+        void const* source;  // null for sprites
+        SourceId id;
+        bool opaque;
+        bool visible;
+        void (*bind)(void const*);  // null for sprites
+        Instance instance;
+        uint32_t pass{};  // see assign_passes()
+    };
+
+    // Sprites bind their registry's names onto units 0 to 2.
+    static auto bind_names(Entry const& entry) -> void {
+        for (size_t i = 0; i < entry.textures.size(); i++) {
+            if (entry.textures[i] != 0) {
+                gl_state().bind_texture(GL_TEXTURE0 + static_cast<GLenum>(i),
+                                        entry.texture_target,
+                                        entry.textures[i]);
+            }
+        }
+    }
+
+    static auto same_batch(Entry const& lhs, Entry const& rhs) -> bool {
+        return lhs.depth == rhs.depth && lhs.program == rhs.program &&
+               lhs.mesh == rhs.mesh && lhs.textures == rhs.textures;
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<Instance> instances_;
+    std::vector<Bounds> occluders_;
+    std::vector<Bounds> pass_bounds_;
+    std::vector<SourceId> visible_sources_;
+    glm::mat4 culled_projection_{};
+    size_t culled_size_{};
+    size_t culled_{};
+    BufferRing instance_ring_{GL_ARRAY_BUFFER, 1024 * sizeof(Instance)};
+    VertexBufferLayout instance_layout_;
+    size_t draw_calls_{};
+};
+
+};  // namespace renderer
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <wnlrenderer/renderer.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+// Bump allocator over one block allocated up front. allocate() is lock-free
+// and may be called from several threads at once; reset() releases
+// everything and must not race with it. Nothing is ever destroyed, so only
+// trivially destructible objects belong here.
+struct FrameArena {
+    explicit FrameArena(size_t capacity)
+        : storage_(std::make_unique<std::byte[]>(capacity))
+        , capacity_(capacity) {
+    }
+
+    // Null once the arena is full.
+    auto allocate(size_t size, size_t alignment) -> void* {
+        auto base = reinterpret_cast<uintptr_t>(storage_.get());  // NOLINT
+        auto head = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto start =
+                ((base + head + alignment - 1) & ~(alignment - 1)) - base;
+            if (start + size > capacity_) {
+                return nullptr;
+            }
+            if (head_.compare_exchange_weak(head, start + size,
+                                            std::memory_order_relaxed)) {
+                return storage_.get() + start;
+            }
+        }
+    }
+
+    template <typename T, typename... Args>
+        requires std::is_trivially_destructible_v<T>
+    auto create(Args&&... args) -> T* {
+        void* memory = allocate(sizeof(T), alignof(T));
+        return memory != nullptr ? new (memory) T{std::forward<Args>(args)...}
+                                 : nullptr;
+    }
+
+    auto reset() noexcept -> void {
+        head_.store(0, std::memory_order_relaxed);
+    }
+
+    auto get_used() const noexcept -> size_t {
+        return head_.load(std::memory_order_relaxed);
+    }
+
+    auto get_capacity() const noexcept -> size_t {
+        return capacity_;
+    }
+
+private:
+    std::unique_ptr<std::byte[]> storage_;
+    size_t capacity_;
+    std::atomic<size_t> head_{0};
+};
+
+// Everything replay() needs for one draw, captured by value so the scene may
+// change while an earlier frame is being submitted. The program and mesh are
+// referenced and must outlive the replay.
+struct DrawPacket {
+    ShaderProgram const* program;
+    Mesh* mesh;
+    GLenum texture_target;
+    std::array<GLuint, 3> textures;  // units 0 to 2, 0 for none
+    float layer;
+    glm::mat4 transform;
+};
+
+static_assert(std::is_trivially_copyable_v<DrawPacket>);
+
+// Binds the packet's textures, and its layer for array textures.
+inline auto bind_textures(DrawPacket const& packet) -> void {
+    for (size_t i = 0; i < packet.textures.size(); i++) {
+        if (packet.textures[i] != 0) {
+            gl_state().bind_texture(GL_TEXTURE0 + static_cast<GLenum>(i),
+                                    packet.texture_target, packet.textures[i]);
+        }
+    }
+    if (packet.texture_target == GL_TEXTURE_2D_ARRAY) {
+        glVertexAttrib1f(attribute::layer, packet.layer);
+    }
+}
+
+// Layer in the top bits keeps back-to-front order between layers; within a
+// layer, draws sharing a program and first texture replay back to back.
+constexpr auto make_sort_key(uint16_t layer, GLuint program, GLuint texture)
+    -> uint64_t {
+    return (uint64_t{layer} << 48) | ((uint64_t{program} & 0xFFFFU) << 32) |
+           uint64_t{texture};
+}
+
+// A frame's draws, recorded without touching GL and replayed later on the
+// thread owning the context. Recording threads may run concurrently; the
+// hand-over to the render thread (a queue, a join) has to order their writes
+// before replay(). Packets live in a FrameArena sized for `max_draws`, so a
+// frame allocates nothing.
+//
+// Keep two and alternate: while the render thread replays one, the scene
+// records the next into the other.
+struct CommandBuffer {
+    explicit CommandBuffer(size_t max_draws)
+        : arena_(max_draws * sizeof(DrawPacket)), entries_(max_draws) {
+    }
+
+    template <int format>
+    auto record(uint64_t key,
+                ShaderProgram const& program,
+                Renderable<format>& renderable) -> void {
+        record(key, {
+                        .program        = &program,
+                        .mesh           = renderable.get_mesh().get(),
+                        .texture_target = renderable.get_texture_target(),
+                        .textures       = renderable.get_texture_ids(),
+                        .layer          = renderable.get_layer(),
+                        .transform      = renderable.get_transform(),
+                    });
+    }
+
+    // A Sprite through the ResourceRegistry owning its resources, both from
+    // registry.h, which builds on this header. Throws on a stale handle.
+    template <typename Registry, typename Sprite>
+        requires requires(Registry const& registry,
+                          ShaderProgram const& program,
+                          Sprite const& sprite) {
+            registry.make_packet(program, sprite);
+        }
+    auto record(uint64_t key,
+                ShaderProgram const& program,
+                Registry const& registry,
+                Sprite const& sprite) -> void {
+        record(key, registry.make_packet(program, sprite));
+    }
+
+    auto record(uint64_t key, DrawPacket const& packet) -> void {
+        auto slot    = count_.fetch_add(1, std::memory_order_relaxed);
+        auto* stored = slot < entries_.size()
+                           ? arena_.create<DrawPacket>(packet)
+                           : nullptr;
+        if (stored == nullptr) {
+            throw std::runtime_error(fmt::format(
+                "CommandBuffer holds {} draws per frame", entries_.size()));
+        }
+        entries_[slot] = {key, static_cast<uint32_t>(slot), stored};
+    }
+
+    // Sorts by key, recording order breaking ties, and issues the draws.
+    // Programs get u_Transform per draw; anything else, such as the
+    // projection, is up to the caller.
+    auto replay() -> void {
+        auto entries = std::span{entries_}.first(size());
+        std::ranges::sort(entries, {}, [](Entry const& entry) {
+            return std::pair{entry.key, entry.sequence};
+        });
+
+        ShaderProgram const* program = nullptr;
+        for (auto const& entry : entries) {
+            auto const& packet = *entry.packet;
+            if (packet.program != program) {
+                program = packet.program;
+                program->use();
+            }
+            bind_textures(packet);
+            program->set<"u_Transform">(packet.transform);
+            packet.mesh->draw();
+        }
+    }
+
+    // Drops the recorded draws, once replay() is done with them.
+    auto reset() noexcept -> void {
+        arena_.reset();
+        count_.store(0, std::memory_order_relaxed);
+    }
+
+    auto size() const noexcept -> size_t {
+        return std::min(count_.load(std::memory_order_relaxed),
+                        entries_.size());
+    }
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t sequence;
+        DrawPacket const* packet;
+    };
+
+    FrameArena arena_;
+    std::vector<Entry> entries_;
+    std::atomic<size_t> count_{0};
+};
+
+};  // namespace renderer
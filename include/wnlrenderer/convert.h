@@ -0,0 +1,586 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <wnlrenderer/profiler.h>
+#include <wnlrenderer/renderer.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace renderer {
+
+// Sources that neither the texture formats nor the YUV shaders take, and
+// that ColorConverter turns into a YuvTexture frame.
+enum class SourceFormat : uint8_t {
+    YUYV,  // packed 4:2:2, Y0 U Y1 V
+    UYVY,  // packed 4:2:2, U Y0 V Y1
+    P010,  // 4:2:0, Y plane then interleaved UV plane, 16-bit little-endian
+           // samples with 10 significant bits at the top
+};
+
+enum class SimdLevel : uint8_t {
+    scalar,
+    sse2,
+    avx2,
+    neon,
+};
+
+// The widest kernels this CPU runs.
+inline auto detect_simd_level() -> SimdLevel {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::avx2;
+    }
+    return __builtin_cpu_supports("sse2") ? SimdLevel::sse2
+                                          : SimdLevel::scalar;
+#elif defined(__ARM_NEON)
+    return SimdLevel::neon;
+#else
+    return SimdLevel::scalar;
+#endif
+}
+
+namespace detail::convert {
+// Two source rows and where they go: two luma rows and one row of chroma,
+// averaged over both. `v` is null for interleaved chroma, all in `u`. On an
+// odd last row both halves point at the same rows.
+struct RowPair {
+    std::array<uint8_t const*, 2> src;
+    std::array<uint8_t*, 2> y;
+    uint8_t* u;
+    uint8_t* v;
+};
+
+using PackedKernel = void (*)(RowPair const& rows, int width);
+// Keeps the high byte of `count` little-endian 16-bit samples.
+using NarrowKernel = void (*)(uint8_t const* src, uint8_t* dst, int count);
+
+struct Kernels {
+    PackedKernel yuyv;
+    PackedKernel uyvy;
+    NarrowKernel narrow;
+};
+
+// Scalar kernels, which the vector ones also use for the last few pixels.
+template <bool uyvy>
+inline auto packed_scalar(RowPair const& rows, int begin, int width) -> void {
+    constexpr int luma   = uyvy ? 1 : 0;
+    constexpr int chroma = 1 - luma;
+    for (int x = begin; x < width; x += 2) {
+        for (size_t row = 0; row < 2; row++) {
+            auto const* src   = rows.src[row] + 2 * x;
+            rows.y[row][x]     = src[luma];
+            rows.y[row][x + 1] = src[luma + 2];
+        }
+        auto const* a = rows.src[0] + 2 * x;
+        auto const* b = rows.src[1] + 2 * x;
+        auto u = static_cast<uint8_t>((a[chroma] + b[chroma] + 1) >> 1);
+        auto v = static_cast<uint8_t>((a[chroma + 2] + b[chroma + 2] + 1) >> 1);
+        if (rows.v != nullptr) {
+            rows.u[x / 2] = u;
+            rows.v[x / 2] = v;
+        } else {
+            rows.u[x]     = u;
+            rows.u[x + 1] = v;
+        }
+    }
+}
+
+inline auto narrow_scalar(uint8_t const* src, uint8_t* dst, int begin,
+                          int count) -> void {
+    for (int i = begin; i < count; i++) {
+        dst[i] = src[2 * i + 1];
+    }
+}
+
+template <bool uyvy>
+inline auto packed_kernel_scalar(RowPair const& rows, int width) -> void {
+    packed_scalar<uyvy>(rows, 0, width);
+}
+
+inline auto narrow_kernel_scalar(uint8_t const* src, uint8_t* dst, int count)
+    -> void {
+    narrow_scalar(src, dst, 0, count);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Even bytes are luma in YUYV, odd ones in UYVY; masking or shifting the
+// 16-bit lanes and packing them back down to bytes separates the two.
+// Stores 16 pixels of luma from `src` and returns their interleaved chroma.
+template <bool uyvy>
+__attribute__((target("sse2"))) inline auto split_sse2(uint8_t const* src,
+                                                       uint8_t* y) -> __m128i {
+    auto const mask = _mm_set1_epi16(0x00FF);
+    auto lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));  // NOLINT
+    auto hi =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + 16));  // NOLINT
+    auto y_lo = uyvy ? _mm_srli_epi16(lo, 8) : _mm_and_si128(lo, mask);
+    auto y_hi = uyvy ? _mm_srli_epi16(hi, 8) : _mm_and_si128(hi, mask);
+    auto c_lo = uyvy ? _mm_and_si128(lo, mask) : _mm_srli_epi16(lo, 8);
+    auto c_hi = uyvy ? _mm_and_si128(hi, mask) : _mm_srli_epi16(hi, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y),  // NOLINT
+                     _mm_packus_epi16(y_lo, y_hi));
+    return _mm_packus_epi16(c_lo, c_hi);
+}
+
+template <bool uyvy>
+__attribute__((target("sse2"))) inline auto packed_sse2(RowPair const& rows,
+                                                        int width) -> void {
+    auto const mask = _mm_set1_epi16(0x00FF);
+    auto const zero = _mm_setzero_si128();
+    int x           = 0;
+    for (; x + 16 <= width; x += 16) {
+        auto uv = _mm_avg_epu8(
+            split_sse2<uyvy>(rows.src[0] + 2 * x, rows.y[0] + x),
+            split_sse2<uyvy>(rows.src[1] + 2 * x, rows.y[1] + x));
+        if (rows.v != nullptr) {
+            _mm_storel_epi64(
+                reinterpret_cast<__m128i*>(rows.u + x / 2),  // NOLINT
+                _mm_packus_epi16(_mm_and_si128(uv, mask), zero));
+            _mm_storel_epi64(
+                reinterpret_cast<__m128i*>(rows.v + x / 2),  // NOLINT
+                _mm_packus_epi16(_mm_srli_epi16(uv, 8), zero));
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rows.u + x),  // NOLINT
+                             uv);
+        }
+    }
+    packed_scalar<uyvy>(rows, x, width);
+}
+
+__attribute__((target("sse2"))) inline auto narrow_sse2(uint8_t const* src,
+                                                        uint8_t* dst,
+                                                        int count) -> void {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        auto const* in =
+            reinterpret_cast<__m128i const*>(src + 2 * i);  // NOLINT
+        auto lo = _mm_srli_epi16(_mm_loadu_si128(in), 8);
+        auto hi = _mm_srli_epi16(_mm_loadu_si128(in + 1), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),  // NOLINT
+                         _mm_packus_epi16(lo, hi));
+    }
+    narrow_scalar(src, dst, i, count);
+}
+
+// As the SSE2 kernels, 32 pixels at a time. AVX2 packs within each 128-bit
+// lane, so every pack is followed by a permute putting the quarters back in
+// order.
+__attribute__((target("avx2"))) inline auto pack_avx2(__m256i lo, __m256i hi)
+    -> __m256i {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+template <bool uyvy>
+__attribute__((target("avx2"))) inline auto split_avx2(uint8_t const* src,
+                                                       uint8_t* y) -> __m256i {
+    auto const mask = _mm256_set1_epi16(0x00FF);
+    auto const* in  = reinterpret_cast<__m256i const*>(src);  // NOLINT
+    auto lo         = _mm256_loadu_si256(in);
+    auto hi         = _mm256_loadu_si256(in + 1);
+    auto y_lo = uyvy ? _mm256_srli_epi16(lo, 8) : _mm256_and_si256(lo, mask);
+    auto y_hi = uyvy ? _mm256_srli_epi16(hi, 8) : _mm256_and_si256(hi, mask);
+    auto c_lo = uyvy ? _mm256_and_si256(lo, mask) : _mm256_srli_epi16(lo, 8);
+    auto c_hi = uyvy ? _mm256_and_si256(hi, mask) : _mm256_srli_epi16(hi, 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(y),  // NOLINT
+                        pack_avx2(y_lo, y_hi));
+    return pack_avx2(c_lo, c_hi);
+}
+
+template <bool uyvy>
+__attribute__((target("avx2"))) inline auto packed_avx2(RowPair const& rows,
+                                                        int width) -> void {
+    auto const mask = _mm256_set1_epi16(0x00FF);
+    auto const zero = _mm256_setzero_si256();
+    int x           = 0;
+    for (; x + 32 <= width; x += 32) {
+        auto uv = _mm256_avg_epu8(
+            split_avx2<uyvy>(rows.src[0] + 2 * x, rows.y[0] + x),
+            split_avx2<uyvy>(rows.src[1] + 2 * x, rows.y[1] + x));
+        if (rows.v != nullptr) {
+            auto u = pack_avx2(_mm256_and_si256(uv, mask), zero);
+            auto v = pack_avx2(_mm256_srli_epi16(uv, 8), zero);
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(rows.u + x / 2),  // NOLINT
+                _mm256_castsi256_si128(u));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(rows.v + x / 2),  // NOLINT
+                _mm256_castsi256_si128(v));
+        } else {
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(rows.u + x),  // NOLINT
+                uv);
+        }
+    }
+    packed_scalar<uyvy>(rows, x, width);
+}
+
+__attribute__((target("avx2"))) inline auto narrow_avx2(uint8_t const* src,
+                                                        uint8_t* dst,
+                                                        int count) -> void {
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        auto const* in =
+            reinterpret_cast<__m256i const*>(src + 2 * i);  // NOLINT
+        auto lo = _mm256_srli_epi16(_mm256_loadu_si256(in), 8);
+        auto hi = _mm256_srli_epi16(_mm256_loadu_si256(in + 1), 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),  // NOLINT
+                            pack_avx2(lo, hi));
+    }
+    narrow_scalar(src, dst, i, count);
+}
+#elif defined(__ARM_NEON)
+// vld2 splits even and odd bytes, so luma and interleaved chroma come out
+// of a single load.
+template <bool uyvy>
+inline auto split_neon(uint8_t const* src, uint8_t* y) -> uint8x16_t {
+    auto bytes = vld2q_u8(src);
+    vst1q_u8(y, bytes.val[uyvy ? 1 : 0]);
+    return bytes.val[uyvy ? 0 : 1];
+}
+
+template <bool uyvy>
+inline auto packed_neon(RowPair const& rows, int width) -> void {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        auto uv =
+            vrhaddq_u8(split_neon<uyvy>(rows.src[0] + 2 * x, rows.y[0] + x),
+                       split_neon<uyvy>(rows.src[1] + 2 * x, rows.y[1] + x));
+        if (rows.v != nullptr) {
+            auto planes = vuzp_u8(vget_low_u8(uv), vget_high_u8(uv));
+            vst1_u8(rows.u + x / 2, planes.val[0]);
+            vst1_u8(rows.v + x / 2, planes.val[1]);
+        } else {
+            vst1q_u8(rows.u + x, uv);
+        }
+    }
+    packed_scalar<uyvy>(rows, x, width);
+}
+
+inline auto narrow_neon(uint8_t const* src, uint8_t* dst, int count) -> void {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(dst + i, vld2q_u8(src + 2 * i).val[1]);
+    }
+    narrow_scalar(src, dst, i, count);
+}
+#endif
+
+inline auto is_supported(SimdLevel level) -> bool {
+    auto best = detect_simd_level();
+    switch (level) {
+        case SimdLevel::scalar:
+            return true;
+        case SimdLevel::sse2:
+            return best == SimdLevel::sse2 || best == SimdLevel::avx2;
+        default:
+            return level == best;
+    }
+}
+
+inline auto kernels_for(SimdLevel level) -> Kernels {
+    if (!is_supported(level)) {
+        throw std::runtime_error(fmt::format(
+            "SIMD level {} is not supported by this CPU or build",
+            static_cast<int>(level)));
+    }
+    switch (level) {
+#if defined(__x86_64__) || defined(__i386__)
+        case SimdLevel::sse2:
+            return {packed_sse2<false>, packed_sse2<true>, narrow_sse2};
+        case SimdLevel::avx2:
+            return {packed_avx2<false>, packed_avx2<true>, narrow_avx2};
+#elif defined(__ARM_NEON)
+        case SimdLevel::neon:
+            return {packed_neon<false>, packed_neon<true>, narrow_neon};
+#endif
+        default:
+            return {packed_kernel_scalar<false>, packed_kernel_scalar<true>,
+                    narrow_kernel_scalar};
+    }
+}
+};  // namespace detail::convert
+
+// A few threads that split a job into chunks of [begin, end) and run it
+// alongside the calling thread. One run() at a time.
+struct ConversionPool {
+    explicit ConversionPool(unsigned threads = default_threads()) {
+        threads_.reserve(threads);
+        for (unsigned i = 0; i < threads; i++) {
+            threads_.emplace_back([this](std::stop_token const& stop_token) {
+                work(stop_token);
+            });
+        }
+    }
+
+    ConversionPool(ConversionPool const&)            = delete;
+    ConversionPool& operator=(ConversionPool const&) = delete;
+    ConversionPool(ConversionPool&&)                 = delete;
+    ConversionPool& operator=(ConversionPool&&)      = delete;
+
+    ~ConversionPool() {
+        for (auto& thread : threads_) {
+            thread.request_stop();
+        }
+    }
+
+    // Leaves a core for the render thread, and a few more for other streams.
+    static auto default_threads() -> unsigned {
+        auto cores = std::thread::hardware_concurrency();
+        return cores > 1 ? std::min(cores - 1, 3U) : 0;
+    }
+
+    // Calls `job` over [0, count) in chunks of at least `min_chunk`,
+    // returning once every chunk is done.
+    auto run(size_t count,
+             size_t min_chunk,
+             std::function<void(size_t, size_t)> const& job) -> void {
+        auto workers = threads_.size() + 1;
+        auto chunk   = std::max(min_chunk, (count + workers - 1) / workers);
+        if (count == 0) {
+            return;
+        }
+        if (threads_.empty() || chunk >= count) {
+            job(0, count);
+            return;
+        }
+        {
+            std::scoped_lock lock{mutex_};
+            job_       = &job;
+            count_     = count;
+            chunk_     = chunk;
+            remaining_ = (count + chunk - 1) / chunk;
+            next_.store(0, std::memory_order_relaxed);
+            generation_++;
+        }
+        wake_.notify_all();
+        drain();
+
+        std::unique_lock lock{mutex_};
+        done_.wait(lock, [this] { return remaining_ == 0 && active_ == 0; });
+        job_ = nullptr;
+    }
+
+    auto get_threads() const noexcept -> size_t {
+        return threads_.size();
+    }
+
+private:
+    auto work(std::stop_token const& stop_token) -> void {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock lock{mutex_};
+                if (!wake_.wait(lock, stop_token, [&] {
+                        return generation_ != seen && job_ != nullptr;
+                    })) {
+                    return;
+                }
+                seen = generation_;
+                active_++;
+            }
+            drain();
+            std::scoped_lock lock{mutex_};
+            active_--;
+            if (remaining_ == 0 && active_ == 0) {
+                done_.notify_all();
+            }
+        }
+    }
+
+    // Takes chunks until there are none left. Workers are counted as active
+    // meanwhile, so the next run() cannot reset next_ under them.
+    auto drain() -> void {
+        size_t finished = 0;
+        for (;;) {
+            auto index = next_.fetch_add(1, std::memory_order_relaxed);
+            auto begin = index * chunk_;
+            if (begin >= count_) {
+                break;
+            }
+            (*job_)(begin, std::min(begin + chunk_, count_));
+            finished++;
+        }
+        std::scoped_lock lock{mutex_};
+        remaining_ -= finished;
+        if (remaining_ == 0 && active_ == 0) {
+            done_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable_any wake_;
+    std::condition_variable_any done_;
+    std::function<void(size_t, size_t)> const* job_{};
+    size_t count_{};
+    size_t chunk_{};
+    size_t remaining_{};
+    size_t active_{};
+    uint64_t generation_{};
+    std::atomic<size_t> next_{0};
+    std::vector<std::jthread> threads_;
+};
+
+// Converts YUYV, UYVY and P010 frames on the CPU, with the widest kernels
+// the CPU runs, straight into a YuvTexture's staging buffer:
+//
+//   auto frame = texture.begin_upload();
+//   converter.convert(SourceFormat::YUYV, data, pitch, texture, frame);
+//   texture.commit(frame);
+//
+// Packed 4:2:2 sources go to I420 or NV12 textures, their chroma averaged
+// over each pair of rows; P010 goes to NV12, keeping the top 8 bits of each
+// sample. Frames are split by rows across a ConversionPool.
+struct ColorConverter {
+    explicit ColorConverter(
+        SimdLevel level = detect_simd_level(),
+        unsigned threads = ConversionPool::default_threads())
+        : level_(level)
+        , kernels_(detail::convert::kernels_for(level))
+        , pool_(threads) {
+    }
+
+    // `pitch` is the source's bytes per row, of luma for P010 (whose chroma
+    // plane follows the luma plane with the same pitch); 0 means packed. At
+    // an odd width, a P010 chroma row is a sample longer than a luma row,
+    // so packed rows are as long as the chroma ones.
+    auto convert(SourceFormat source,
+                 std::span<std::byte const> data,
+                 int pitch,
+                 YuvTexture const& texture,
+                 UploadFrame const& frame) -> void {
+        CpuZone zone{"convert"};
+        auto planes = texture.get_planes();
+        auto width  = planes[0].width;
+        auto height = planes[0].height;
+        if (pitch <= 0) {
+            pitch = row_bytes(source, texture);
+        }
+        check(source, data, pitch, texture, frame);
+
+        auto* base = reinterpret_cast<uint8_t*>(frame.data());  // NOLINT
+        auto plane = [&](size_t i) {
+            return base + texture.plane_offset(i, frame.pitch());
+        };
+        auto const* src = reinterpret_cast<uint8_t const*>(data.data());
+        auto src_pitch  = static_cast<size_t>(pitch);
+        auto y_pitch    = static_cast<size_t>(frame.pitch());
+        auto c_pitch    = static_cast<size_t>(
+            texture.plane_pitch(1, frame.pitch()));
+        auto pairs      = static_cast<size_t>((height + 1) / 2);
+        auto last_row   = static_cast<size_t>(height - 1);
+
+        if (source == SourceFormat::P010) {
+            auto const* src_chroma = src + src_pitch * (last_row + 1);
+            pool_.run(pairs, min_chunk, [&](size_t begin, size_t end) {
+                for (auto pair = begin; pair < end; pair++) {
+                    for (auto row = 2 * pair;
+                         row <= std::min(2 * pair + 1, last_row); row++) {
+                        kernels_.narrow(src + row * src_pitch,
+                                        plane(0) + row * y_pitch, width);
+                    }
+                    kernels_.narrow(src_chroma + pair * src_pitch,
+                                    plane(1) + pair * c_pitch,
+                                    planes[1].width * 2);
+                }
+            });
+            return;
+        }
+
+        auto kernel = source == SourceFormat::YUYV ? kernels_.yuyv
+                                                   : kernels_.uyvy;
+        auto i420   = texture.get_layout() == YuvLayout::I420;
+        pool_.run(pairs, min_chunk, [&](size_t begin, size_t end) {
+            for (auto pair = begin; pair < end; pair++) {
+                auto first  = 2 * pair;
+                auto second = std::min(first + 1, last_row);
+                kernel({.src = {src + first * src_pitch,
+                                src + second * src_pitch},
+                        .y   = {plane(0) + first * y_pitch,
+                                plane(0) + second * y_pitch},
+                        .u   = plane(1) + pair * c_pitch,
+                        .v = i420 ? plane(2) + pair * c_pitch : nullptr},
+                       width);
+            }
+        });
+    }
+
+    auto get_simd_level() const noexcept -> SimdLevel {
+        return level_;
+    }
+
+private:
+    // Row pairs per chunk: smaller chunks cost more in hand-over than the
+    // threads win back.
+    static constexpr size_t min_chunk = 16;
+
+    // The longest row of `source` a frame for `texture` has.
+    static auto row_bytes(SourceFormat source, YuvTexture const& texture)
+        -> int {
+        auto planes = texture.get_planes();
+        return source == SourceFormat::P010 ? planes[1].width * 4
+                                            : planes[0].width * 2;
+    }
+
+    static auto check(SourceFormat source,
+                      std::span<std::byte const> data,
+                      int pitch,
+                      YuvTexture const& texture,
+                      UploadFrame const& frame) -> void {
+        auto planes = texture.get_planes();
+        auto width  = planes[0].width;
+        auto height = planes[0].height;
+        if (source == SourceFormat::P010) {
+            if (texture.get_layout() != YuvLayout::NV12) {
+                throw std::runtime_error("P010 converts to NV12 textures only");
+            }
+            auto row = row_bytes(source, texture);
+            if (pitch < row) {
+                throw std::runtime_error(fmt::format(
+                    "P010 pitch of {} bytes is below the {} a chroma row needs",
+                    pitch, row));
+            }
+            detail::check_upload_size(data.size(), pitch, row,
+                                      height + planes[1].height);
+        } else {
+            if (texture.get_layout() == YuvLayout::NV21) {
+                throw std::runtime_error(
+                    "Packed YUV converts to I420 or NV12 textures only");
+            }
+            if (width % 2 != 0) {
+                throw std::runtime_error(fmt::format(
+                    "Packed YUV needs an even width, not {}", width));
+            }
+            detail::check_upload_size(data.size(), pitch, width * 2, height);
+        }
+        if (frame.size() < texture.frame_size(frame.pitch())) {
+            throw std::runtime_error(fmt::format(
+                "Upload frame too small: {} bytes, expected {}", frame.size(),
+                texture.frame_size(frame.pitch())));
+        }
+    }
+
+    SimdLevel level_;
+    detail::convert::Kernels kernels_;
+    ConversionPool pool_;
+};
+
+};  // namespace renderer
@@ -0,0 +1,278 @@
+#pragma once
+
+#ifdef WNLRENDERER_EGL
+#ifndef EGL_NO_X11
+#define EGL_NO_X11
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#include <wnlrenderer/registry.h>
+#include <wnlrenderer/renderer.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <glm/glm.hpp>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer {
+
+inline auto bounds_of(std::span<Rect const> rects) -> Rect {
+    Rect bounds{};
+    for (auto const& rect : rects) {
+        bounds = bounds.united(rect);
+    }
+    return bounds;
+}
+
+// glScissor() counts rows from the bottom of the viewport.
+inline auto scissor(Rect const& rect, int viewport_height) -> void {
+    glScissor(rect.x, viewport_height - rect.y - rect.height, rect.width,
+              rect.height);
+}
+
+// Screen area covered by a quad spanning -0.5..0.5 under `transform`.
+inline auto bounds_of(glm::mat4 const& transform) -> Rect {
+    auto min = glm::vec2{std::numeric_limits<float>::max()};
+    auto max = glm::vec2{std::numeric_limits<float>::lowest()};
+    for (auto corner : {glm::vec2{-0.5F, -0.5F}, glm::vec2{0.5F, -0.5F},
+                        glm::vec2{-0.5F, 0.5F}, glm::vec2{0.5F, 0.5F}}) {
+        auto point = transform * glm::vec4{corner.x, corner.y, 0.0F, 1.0F};
+        min        = glm::min(min, glm::vec2{point.x, point.y});
+        max        = glm::max(max, glm::vec2{point.x, point.y});
+    }
+    auto left = static_cast<int>(std::floor(min.x));
+    auto top  = static_cast<int>(std::floor(min.y));
+    return {left, top, static_cast<int>(std::ceil(max.x)) - left,
+            static_cast<int>(std::ceil(max.y)) - top};
+}
+
+// Works out which parts of the window a frame has to repaint. Each frame,
+// track() every renderable that will be drawn, then call end_frame(): an
+// empty result means the frame must be skipped, swap included, since buffer
+// ages only count presented frames. Otherwise scissor to the result (or
+// draw everything) and swap.
+//
+// Renderables are identified by address and must stay put between frames
+// they are tracked in; sprites are identified by their registry handle.
+// Something that changes behind a renderable's back, e.g. an ExternalTexture
+// without mark_updated(), needs invalidate().
+struct DamageTracker {
+    // `history` bounds the buffer age end_frame() can make use of.
+    explicit DamageTracker(size_t history = 4) : history_(history) {
+    }
+
+    template <int format>
+    auto track(Renderable<format>& renderable) -> void {
+        track({&renderable, 0}, bounds_of(renderable.get_transform()),
+              {renderable.get_revision(), {}});
+    }
+
+    // Throws on a stale handle.
+    auto track(ResourceRegistry const& registry, SpriteHandle handle)
+        -> void {
+        auto const& sprite = registry.get_sprite(handle);
+        track({&registry, handle.value},
+              bounds_of(compose_2d(sprite.position, sprite.scale)),
+              {registry.get_revision(sprite.texture), sprite});
+    }
+
+    auto invalidate(Rect const& rect) -> void {
+        damage_.push_back(rect);
+    }
+
+    auto invalidate_all() -> void {
+        full_ = true;
+    }
+
+    // Damage to repaint into a back buffer that last held the frame drawn
+    // `buffer_age` frames ago, as EGL_EXT_buffer_age reports it; 0 means its
+    // contents are unknown, which turns any damage into a full repaint.
+    auto end_frame(int width, int height, int buffer_age = 0)
+        -> std::span<Rect const> {
+        for (auto it = tracked_.begin(); it != tracked_.end();) {
+            if (it->second.frame != frame_) {
+                damage_.push_back(it->second.bounds);
+                it = tracked_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (width != width_ || height != height_) {
+            width_  = width;
+            height_ = height;
+            full_   = true;
+        }
+
+        Frame frame{full_, {}};
+        for (auto const& rect : damage_) {
+            if (auto clipped = rect.clipped(width, height); !clipped.empty()) {
+                frame.rects.push_back(clipped);
+            }
+        }
+        damage_.clear();
+        full_ = false;
+        frame_++;
+
+        result_.clear();
+        if (!frame.full && frame.rects.empty()) {
+            // Not presented, so no back buffer ages and the history keeps
+            // the damage older buffers still miss.
+            return result_;
+        }
+        frames_.push_front(std::move(frame));
+        if (frames_.size() > history_) {
+            frames_.pop_back();
+        }
+
+        // The back buffer misses this frame's damage and that of the
+        // `buffer_age - 1` frames before it.
+        auto age = static_cast<size_t>(std::max(buffer_age, 0));
+        if (age == 0 || age > frames_.size()) {
+            result_.push_back({0, 0, width, height});
+            return result_;
+        }
+        for (size_t i = 0; i < age; i++) {
+            auto const& past = frames_[i];
+            if (past.full) {
+                result_.assign({Rect{0, 0, width, height}});
+                return result_;
+            }
+            result_.insert(result_.end(), past.rects.begin(),
+                           past.rects.end());
+        }
+        return result_;
+    }
+
+private:
+    // A sprite has no revision of its own, so its fields are compared.
+    struct Revision {
+        uint64_t contents;
+        Sprite sprite;
+
+        auto operator==(Revision const&) const -> bool = default;
+    };
+
+    struct Entry {
+        Rect bounds;
+        Revision revision;
+        uint64_t frame;
+    };
+
+    struct SourceHash {
+        auto operator()(SourceId const& source) const noexcept -> size_t {
+            return std::hash<void const*>{}(source.owner) ^
+                   (std::hash<uint32_t>{}(source.sprite) << 1U);
+        }
+    };
+
+    auto track(SourceId const& source,
+               Rect const& bounds,
+               Revision const& revision) -> void {
+        auto [it, inserted] = tracked_.try_emplace(source);
+        auto& entry         = it->second;
+        if (inserted) {
+            damage_.push_back(bounds);
+        } else if (entry.revision != revision) {
+            damage_.push_back(entry.bounds);
+            damage_.push_back(bounds);
+        }
+        entry = {bounds, revision, frame_};
+    }
+
+    struct Frame {
+        bool full;
+        std::vector<Rect> rects;
+    };
+
+    size_t history_;
+    std::unordered_map<SourceId, Entry, SourceHash> tracked_;
+    std::vector<Rect> damage_;
+    bool full_{true};
+    std::deque<Frame> frames_;
+    std::vector<Rect> result_;
+    uint64_t frame_{};
+    int width_{};
+    int height_{};
+};
+
+// Presenting only the damage goes through EGL; build with WNLRENDERER_EGL.
+#ifdef WNLRENDERER_EGL
+namespace detail {
+struct DamageSwapFunctions {
+    EGLBoolean(GLAD_API_PTR* query_surface)(EGLDisplay,
+                                            EGLSurface,
+                                            EGLint,
+                                            EGLint*);
+    EGLBoolean(GLAD_API_PTR* swap_with_damage)(EGLDisplay,
+                                               EGLSurface,
+                                               EGLint const*,
+                                               EGLint);
+};
+
+inline auto damage_swap_functions() -> DamageSwapFunctions& {
+    static DamageSwapFunctions functions{};
+    return functions;
+}
+};  // namespace detail
+
+// Loads eglSwapBuffersWithDamage{KHR,EXT} through the loader used for glad,
+// on an EGL context. Returns false when the EGL has neither, in which case
+// swap_buffers_with_damage() is unavailable and a plain swap has to do.
+inline auto load_swap_with_damage(GLADloadfunc load) -> bool {
+    auto& functions         = detail::damage_swap_functions();
+    functions.query_surface = reinterpret_cast<  // NOLINT
+        decltype(functions.query_surface)>(load("eglQuerySurface"));
+    functions.swap_with_damage = reinterpret_cast<  // NOLINT
+        decltype(functions.swap_with_damage)>(
+        load("eglSwapBuffersWithDamageKHR"));
+    if (functions.swap_with_damage == nullptr) {
+        functions.swap_with_damage = reinterpret_cast<  // NOLINT
+            decltype(functions.swap_with_damage)>(
+            load("eglSwapBuffersWithDamageEXT"));
+    }
+    return functions.query_surface != nullptr &&
+           functions.swap_with_damage != nullptr;
+}
+
+// EGL_EXT_buffer_age of the surface's back buffer; 0 when unknown.
+inline auto buffer_age(EGLDisplay display, EGLSurface surface) -> int {
+    EGLint age = 0;
+    auto const& functions = detail::damage_swap_functions();
+    if (functions.query_surface == nullptr ||
+        functions.query_surface(display, surface, EGL_BUFFER_AGE_EXT, &age) ==
+            EGL_FALSE) {
+        return 0;
+    }
+    return age;
+}
+
+// Presents, telling the compositor only `damage` changed. Requires
+// load_swap_with_damage() to have succeeded.
+inline auto swap_buffers_with_damage(EGLDisplay display,
+                                     EGLSurface surface,
+                                     std::span<Rect const> damage,
+                                     int viewport_height) -> bool {
+    // EGL wants x, y, width, height with a bottom-left origin.
+    std::vector<EGLint> rects;
+    rects.reserve(damage.size() * 4);
+    for (auto const& rect : damage) {
+        rects.insert(rects.end(),
+                     {rect.x, viewport_height - rect.y - rect.height,
+                      rect.width, rect.height});
+    }
+    return detail::damage_swap_functions().swap_with_damage(
+               display, surface, rects.data(),
+               static_cast<EGLint>(damage.size())) == EGL_TRUE;
+}
+#endif
+
+};  // namespace renderer
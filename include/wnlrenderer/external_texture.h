@@ -0,0 +1,312 @@
+#pragma once
+
+#ifndef EGL_NO_X11
+#define EGL_NO_X11
+#endif
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <fmt/format.h>
+#include <glad/gles2.h>
+#include <wnlrenderer/gl_state.h>
+#include <wnlrenderer/renderer.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Zero-copy import of decoder dmabufs through EGLImage. Needs the EGL
+// headers; build with WNLRENDERER_EGL, which also lets Renderable and
+// ResourceRegistry take an ExternalTexture.
+namespace renderer {
+
+// glad is generated without extensions, so the entry points used to import
+// dmabufs are loaded by load_egl_image().
+namespace detail {
+struct EglImageFunctions {
+    PFNEGLCREATEIMAGEKHRPROC create_image;
+    PFNEGLDESTROYIMAGEKHRPROC destroy_image;
+    EGLint(GLAD_API_PTR* get_error)();
+    void(GLAD_API_PTR* image_target_texture)(GLenum, void*);
+};
+
+inline auto egl_image_functions() -> EglImageFunctions& {
+    static EglImageFunctions functions{};
+    return functions;
+}
+};  // namespace detail
+
+// Call once after gladLoadGLES2() with the same loader. The context has to be
+// an EGL one (e.g. GLFW_CONTEXT_CREATION_API = GLFW_EGL_CONTEXT_API) exposing
+// EGL_EXT_image_dma_buf_import and GL_OES_EGL_image_external.
+inline auto load_egl_image(GLADloadfunc load) -> void {
+    auto& functions = detail::egl_image_functions();
+    auto load_as    = [load]<typename F>(F& function, char const* name) {
+        function = reinterpret_cast<F>(load(name));  // NOLINT
+        return function != nullptr;
+    };
+
+    if (!load_as(functions.create_image, "eglCreateImageKHR") ||
+        !load_as(functions.destroy_image, "eglDestroyImageKHR") ||
+        !load_as(functions.get_error, "eglGetError") ||
+        !load_as(functions.image_target_texture,
+                 "glEGLImageTargetTexture2DOES")) {
+        throw std::runtime_error("EGLImage dmabuf import is not supported");
+    }
+}
+
+namespace drm_format {
+constexpr auto fourcc(char a, char b, char c, char d) -> uint32_t {
+    auto byte = [](char ch) { return static_cast<uint32_t>(ch); };
+    return byte(a) | (byte(b) << 8U) | (byte(c) << 16U) | (byte(d) << 24U);
+}
+
+constexpr uint32_t r8     = fourcc('R', '8', ' ', ' ');
+constexpr uint32_t gr88   = fourcc('G', 'R', '8', '8');
+constexpr uint32_t nv12   = fourcc('N', 'V', '1', '2');
+constexpr uint32_t nv21   = fourcc('N', 'V', '2', '1');
+constexpr uint32_t yuv420 = fourcc('Y', 'U', '1', '2');
+
+constexpr uint64_t mod_invalid = 0x00FFFFFFFFFFFFFFULL;
+};  // namespace drm_format
+
+struct DmaBufPlane {
+    int fd;
+    uint32_t offset;
+    uint32_t pitch;
+    uint64_t modifier = drm_format::mod_invalid;
+};
+
+// A decoder output buffer, described the way V4L2 and VA-API export it.
+struct DmaBufFrame {
+    uint32_t fourcc;
+    GLsizei width;
+    GLsizei height;
+    std::array<DmaBufPlane, 3> planes;
+    size_t plane_count;
+};
+
+enum class ExternalSampling : uint8_t {
+    // One GL_TEXTURE_EXTERNAL_OES texture, sampled through samplerExternalOES
+    // with the driver doing the YUV conversion.
+    External,
+    // One R8/RG8 texture per plane, bound like YuvTexture so the yuv, nv12 and
+    // nv21 shaders apply unchanged. Needs an NV12, NV21 or YUV420 frame.
+    Planes,
+};
+
+// Textures sampling a dmabuf in place, so decoded video never passes through
+// the CPU. Importing is not free: keep one ExternalTexture per buffer of the
+// decoder's pool rather than one per frame. The dmabuf fds stay owned by the
+// caller and may be closed once this is constructed.
+struct ExternalTexture {
+    ExternalTexture(EGLDisplay display,
+                    DmaBufFrame const& frame,
+                    ExternalSampling sampling)
+        : display_(display)
+        , target_(sampling == ExternalSampling::External
+                      ? GL_TEXTURE_EXTERNAL_OES
+                      : GL_TEXTURE_2D) {
+        if (frame.plane_count == 0 || frame.plane_count > frame.planes.size()) {
+            throw std::runtime_error(fmt::format(
+                "dmabuf frame has {} planes, expected 1 to {}",
+                frame.plane_count, frame.planes.size()));
+        }
+        // No destructor runs if a later plane fails to import.
+        try {
+            import_planes(frame, sampling);
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~ExternalTexture() {
+        release();
+    }
+
+    ExternalTexture(ExternalTexture const&)            = delete;
+    ExternalTexture& operator=(ExternalTexture const&) = delete;
+
+    ExternalTexture(ExternalTexture&& other) noexcept
+        : display_(other.display_)
+        , target_(other.target_)
+        , layout_(other.layout_)
+        , planes_(other.planes_)
+        , plane_count_(std::exchange(other.plane_count_, 0))
+        , revision_(other.revision_) {
+    }
+
+    ExternalTexture& operator=(ExternalTexture&& other) noexcept {
+        std::ranges::swap(other.display_, display_);
+        std::ranges::swap(other.target_, target_);
+        std::ranges::swap(other.layout_, layout_);
+        std::ranges::swap(other.planes_, planes_);
+        std::ranges::swap(other.plane_count_, plane_count_);
+        std::ranges::swap(other.revision_, revision_);
+        return *this;
+    }
+
+    // Binds plane i to texture unit `first_unit + i`.
+    auto bind(GLenum first_unit = GL_TEXTURE0) const -> void {
+        auto unit = first_unit;
+        for (auto const& plane : get_planes()) {
+            gl_state().bind_texture(unit++, target_, plane.texture);
+        }
+    }
+
+    struct Plane {
+        GLuint texture;
+        EGLImageKHR image;
+    };
+
+    auto get_planes() const -> std::span<Plane const> {
+        return std::span{planes_}.first(plane_count_);
+    }
+
+    auto get_target() const noexcept -> GLenum {
+        return target_;
+    }
+
+    // Layout of the planes in ExternalSampling::Planes mode.
+    auto get_layout() const noexcept -> YuvLayout {
+        return layout_;
+    }
+
+    // The buffer is written behind GL's back; call this once the decoder has
+    // produced a new frame into it.
+    auto mark_updated() noexcept -> void {
+        revision_++;
+    }
+
+    auto get_revision() const noexcept -> uint64_t {
+        return revision_;
+    }
+
+private:
+    auto import_planes(DmaBufFrame const& frame, ExternalSampling sampling)
+        -> void {
+        auto planes = std::span{frame.planes}.first(frame.plane_count);
+        if (sampling == ExternalSampling::External) {
+            import_plane(frame.fourcc, frame.width, frame.height, planes);
+            return;
+        }
+
+        layout_ = layout_of(frame.fourcc);
+        if (planes.size() != (layout_ == YuvLayout::I420 ? 3U : 2U)) {
+            throw std::runtime_error(fmt::format(
+                "dmabuf frame has {} planes, its format needs {}",
+                planes.size(), layout_ == YuvLayout::I420 ? 3 : 2));
+        }
+        GLsizei chroma_width  = (frame.width + 1) / 2;
+        GLsizei chroma_height = (frame.height + 1) / 2;
+        auto chroma_format    = layout_ == YuvLayout::I420 ? drm_format::r8
+                                                           : drm_format::gr88;
+
+        import_plane(drm_format::r8, frame.width, frame.height,
+                     planes.subspan(0, 1));
+        for (size_t i = 1; i < planes.size(); i++) {
+            import_plane(chroma_format, chroma_width, chroma_height,
+                         planes.subspan(i, 1));
+        }
+    }
+
+    auto release() -> void {
+        for (auto const& plane : get_planes()) {
+            gl_state().forget_texture(plane.texture);
+            glDeleteTextures(1, &plane.texture);
+            detail::egl_image_functions().destroy_image(display_, plane.image);
+        }
+        plane_count_ = 0;
+    }
+
+    static auto layout_of(uint32_t fourcc) -> YuvLayout {
+        switch (fourcc) {
+            case drm_format::nv12:
+                return YuvLayout::NV12;
+            case drm_format::nv21:
+                return YuvLayout::NV21;
+            case drm_format::yuv420:
+                return YuvLayout::I420;
+            default:
+                throw std::runtime_error(fmt::format(
+                    "No per-plane import for DRM format {:#010x}", fourcc));
+        }
+    }
+
+    auto import_plane(uint32_t fourcc,
+                      GLsizei width,
+                      GLsizei height,
+                      std::span<DmaBufPlane const> planes) -> void {
+        // EGL_DMA_BUF_PLANE<i>_{FD, OFFSET, PITCH, MODIFIER_LO, MODIFIER_HI}
+        constexpr std::array<std::array<EGLint, 5>, 3> plane_keys{{
+            {EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+             EGL_DMA_BUF_PLANE0_PITCH_EXT, EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,
+             EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT},
+            {EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+             EGL_DMA_BUF_PLANE1_PITCH_EXT, EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT,
+             EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT},
+            {EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+             EGL_DMA_BUF_PLANE2_PITCH_EXT, EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT,
+             EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT},
+        }};
+
+        std::vector<EGLint> attributes{
+            EGL_WIDTH,
+            width,
+            EGL_HEIGHT,
+            height,
+            EGL_LINUX_DRM_FOURCC_EXT,
+            static_cast<EGLint>(fourcc),
+        };
+        for (size_t i = 0; i < planes.size(); i++) {
+            auto const& plane = planes[i];
+            auto const& keys  = plane_keys[i];
+            attributes.insert(attributes.end(),
+                              {keys[0], plane.fd, keys[1],
+                               static_cast<EGLint>(plane.offset), keys[2],
+                               static_cast<EGLint>(plane.pitch)});
+            if (plane.modifier != drm_format::mod_invalid) {
+                attributes.insert(
+                    attributes.end(),
+                    {keys[3], static_cast<EGLint>(plane.modifier & 0xFFFFFFFFU),
+                     keys[4], static_cast<EGLint>(plane.modifier >> 32U)});
+            }
+        }
+        attributes.push_back(EGL_NONE);
+
+        auto const& functions = detail::egl_image_functions();
+        EGLImageKHR image     = functions.create_image(
+            display_, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr,
+            attributes.data());
+        if (image == EGL_NO_IMAGE_KHR) {
+            throw std::runtime_error(
+                fmt::format("Failed to import dmabuf (EGL error {:#x})",
+                            functions.get_error()));
+        }
+
+        auto& plane = planes_[plane_count_++];
+        plane.image = image;
+        glGenTextures(1, &plane.texture);
+        gl_state().bind_texture(target_, plane.texture);
+
+        glTexParameteri(target_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        functions.image_target_texture(target_, image);
+    }
+
+    EGLDisplay display_;
+    GLenum target_;
+    YuvLayout layout_{};
+    std::array<Plane, 3> planes_{};
+    size_t plane_count_{};
+    uint64_t revision_{};
+};
+
+};  // namespace renderer
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace renderer {
+
+using PresentClock = std::chrono::steady_clock;
+
+// Bounded single-producer/single-consumer ring of decoded frames. Neither side
+// ever blocks: a full queue rejects the push, an empty one returns nothing.
+// Use one queue per decoder.
+template <typename Frame, size_t Capacity = 4>
+    requires(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0 &&
+             std::is_default_constructible_v<Frame> &&
+             std::is_move_assignable_v<Frame>)
+struct FrameQueue {
+    // Producer side.
+    auto try_push(Frame frame) -> bool {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == Capacity) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == Capacity) {
+                return false;
+            }
+        }
+        slots_[tail & mask] = std::move(frame);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: the oldest frame, or nullptr when empty. Stays valid
+    // until pop().
+    auto front() -> Frame* {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask];
+    }
+
+    auto pop() -> void {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    auto try_pop() -> std::optional<Frame> {
+        auto* frame = front();
+        if (frame == nullptr) {
+            return std::nullopt;
+        }
+        std::optional<Frame> result{std::move(*frame)};
+        pop();
+        return result;
+    }
+
+    static constexpr auto capacity() noexcept -> size_t {
+        return Capacity;
+    }
+
+private:
+    static constexpr size_t mask = Capacity - 1;
+    static constexpr size_t cache_line = 64;
+
+    alignas(cache_line) std::atomic<size_t> head_{0};
+    size_t tail_cache_{0};  // consumer's last view of tail_
+    alignas(cache_line) std::atomic<size_t> tail_{0};
+    size_t head_cache_{0};  // producer's last view of head_
+    alignas(cache_line) std::array<Frame, Capacity> slots_{};
+};
+
+template <typename Frame>
+concept TimedFrame = requires(Frame const& frame) {
+    { frame.pts } -> std::convertible_to<PresentClock::time_point>;
+};
+
+struct PacingStats {
+    uint64_t presented;
+    uint64_t dropped;
+    uint64_t held;
+};
+
+// Picks, for each vsync, the newest queued frame that is due by then. Older
+// due frames are dropped and frames due after the vsync stay queued.
+template <TimedFrame Frame>
+struct FramePacer {
+    explicit FramePacer(PresentClock::duration refresh_interval =
+                            std::chrono::microseconds{16'667})
+        : interval_(refresh_interval) {
+    }
+
+    // Frame to show at the vsync at `vsync`, or nullopt to keep showing the
+    // current one.
+    template <size_t N>
+    auto select(FrameQueue<Frame, N>& queue, PresentClock::time_point vsync)
+        -> std::optional<Frame> {
+        auto deadline = vsync + (interval_ / 2);
+
+        std::optional<Frame> chosen;
+        while (auto* frame = queue.front()) {
+            if (PresentClock::time_point{frame->pts} > deadline) {
+                if (!chosen) {
+                    stats_.held++;
+                }
+                break;
+            }
+            if (chosen) {
+                stats_.dropped++;
+            }
+            chosen = std::move(*frame);
+            queue.pop();
+        }
+        if (chosen) {
+            stats_.presented++;
+        }
+        return chosen;
+    }
+
+    template <size_t N>
+    auto select(FrameQueue<Frame, N>& queue) -> std::optional<Frame> {
+        return select(queue, next_vsync());
+    }
+
+    // Call right after each buffer swap; with a swap interval of 1 the swap
+    // returning tracks the display's vsync, which refines the interval.
+    auto on_present(PresentClock::time_point swapped = PresentClock::now())
+        -> void {
+        if (last_present_) {
+            auto measured = swapped - *last_present_;
+            // Ignore missed vsyncs and stalls, they do not move the refresh.
+            if (measured < interval_ * 3 / 2) {
+                interval_ += (measured - interval_) / 8;
+            }
+        }
+        last_present_ = swapped;
+    }
+
+    // First vsync still ahead, stepping over any the caller let pass without
+    // presenting (e.g. frames skipped because nothing changed).
+    auto next_vsync() const -> PresentClock::time_point {
+        auto now = PresentClock::now();
+        if (!last_present_) {
+            return now + interval_;
+        }
+        auto next = *last_present_ + interval_;
+        if (next < now) {
+            next += ((now - next) / interval_ + 1) * interval_;
+        }
+        return next;
+    }
+
+    auto get_refresh_interval() const noexcept -> PresentClock::duration {
+        return interval_;
+    }
+
+    auto get_stats() const noexcept -> PacingStats {
+        return stats_;
+    }
+
+private:
+    PresentClock::duration interval_;
+    std::optional<PresentClock::time_point> last_present_;
+    PacingStats stats_{};
+};
+
+};  // namespace renderer
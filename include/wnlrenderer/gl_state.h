@@ -0,0 +1,276 @@
+#pragma once
+
+#include <glad/gles2.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Not in the generated glad header, which has no extensions.
+#ifndef GL_TEXTURE_EXTERNAL_OES
+#define GL_TEXTURE_EXTERNAL_OES 0x8D65
+#endif
+
+namespace renderer {
+
+struct GLStateStats {
+    uint64_t issued;
+    uint64_t skipped;
+};
+
+// Shadow of the binding state of the context current on this thread. Every
+// wrapper binds through it so redundant binds never reach the driver.
+//
+// Precondition: reset() whenever a context is made current on the thread,
+// since the shadow cannot know what another thread left bound.
+//
+// Programs, buffers and textures may be shared between contexts, and any
+// thread may delete them; vertex arrays are per context and must be deleted
+// by the thread that uses them.
+struct GLState {
+    static constexpr size_t max_texture_units = 16;
+
+    GLState() {
+        reset();
+    }
+
+    auto use_program(GLuint program) -> void {
+        sync_shared();
+        if (update(program_, program)) {
+            glUseProgram(program);
+        }
+    }
+
+    auto bind_vertex_array(GLuint vao) -> void {
+        if (update(vertex_array_, vao)) {
+            glBindVertexArray(vao);
+            // The element array binding is part of the VAO.
+            buffers_[buffer_index(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+        }
+    }
+
+    auto bind_buffer(GLenum target, GLuint buffer) -> void {
+        sync_shared();
+        auto index = buffer_index(target);
+        if (index == untracked) {
+            glBindBuffer(target, buffer);
+            stats_.issued++;
+        } else if (update(buffers_[index], buffer)) {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    // For writing to a buffer rather than drawing from it. The element array
+    // binding belongs to the bound VAO, so that target is bound with no VAO
+    // bound, and the last mesh drawn keeps its index buffer.
+    auto bind_upload_buffer(GLenum target, GLuint buffer) -> void {
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            bind_vertex_array(0);
+        }
+        bind_buffer(target, buffer);
+    }
+
+    // Indexed binds always go through, but they also replace the generic
+    // binding of `target`.
+    auto bind_buffer_range(GLenum target,
+                           GLuint index,
+                           GLuint buffer,
+                           GLintptr offset,
+                           GLsizeiptr size) -> void {
+        glBindBufferRange(target, index, buffer, offset, size);
+        note_buffer(target, buffer);
+        stats_.issued++;
+    }
+
+    auto bind_buffer_base(GLenum target, GLuint index, GLuint buffer)
+        -> void {
+        glBindBufferBase(target, index, buffer);
+        note_buffer(target, buffer);
+        stats_.issued++;
+    }
+
+    auto active_texture(GLenum unit) -> void {
+        if (update(active_unit_, unit)) {
+            glActiveTexture(unit);
+        }
+    }
+
+    // Binds to the active texture unit.
+    auto bind_texture(GLenum target, GLuint texture) -> void {
+        sync_shared();
+        auto unit = static_cast<size_t>(active_unit_ - GL_TEXTURE0);
+        auto slot = texture_index(target);
+        if (active_unit_ == unknown || unit >= max_texture_units ||
+            slot == untracked) {
+            glBindTexture(target, texture);
+            stats_.issued++;
+        } else if (update(textures_[unit][slot], texture)) {
+            glBindTexture(target, texture);
+        }
+    }
+
+    auto bind_texture(GLenum unit, GLenum target, GLuint texture) -> void {
+        active_texture(unit);
+        bind_texture(target, texture);
+    }
+
+    // Deleting an object unbinds it, and its name may be reused; forget it so
+    // the next bind of that name is not skipped. Shared objects stay bound to
+    // the other contexts under their old name, so forgetting one drops the
+    // shared bindings every thread has cached.
+    auto forget_program(GLuint program) -> void {
+        forget(program_, program);
+        invalidate_shared();
+    }
+
+    auto forget_vertex_array(GLuint vao) -> void {
+        forget(vertex_array_, vao);
+    }
+
+    auto forget_buffer(GLuint buffer) -> void {
+        for (auto& bound : buffers_) {
+            forget(bound, buffer);
+        }
+        invalidate_shared();
+    }
+
+    auto forget_texture(GLuint texture) -> void {
+        for (auto& unit : textures_) {
+            for (auto& bound : unit) {
+                forget(bound, texture);
+            }
+        }
+        invalidate_shared();
+    }
+
+    // A change another context made to a shared object is only guaranteed
+    // to show here once the object is bound again (GLES 3.2 appendix D.3.3).
+    // After waiting on one, forget the shared bindings so the next binds
+    // reach GL.
+    auto forget_shared() -> void {
+        generation_ = shared_generation().load(std::memory_order_acquire);
+        program_    = unknown;
+        buffers_.fill(unknown);
+        for (auto& unit : textures_) {
+            unit.fill(unknown);
+        }
+    }
+
+    auto reset() -> void {
+        vertex_array_ = unknown;
+        active_unit_  = unknown;
+        forget_shared();
+    }
+
+    auto get_stats() const noexcept -> GLStateStats {
+        return stats_;
+    }
+
+    auto reset_stats() noexcept -> void {
+        stats_ = {};
+    }
+
+private:
+    static constexpr GLuint unknown   = ~GLuint{0};
+    static constexpr size_t untracked = ~size_t{0};
+
+    static constexpr auto buffer_index(GLenum target) -> size_t {
+        switch (target) {
+            case GL_ARRAY_BUFFER:
+                return 0;
+            case GL_ELEMENT_ARRAY_BUFFER:
+                return 1;
+            case GL_PIXEL_UNPACK_BUFFER:
+                return 2;
+            case GL_UNIFORM_BUFFER:
+                return 3;
+            default:
+                return untracked;
+        }
+    }
+
+    static constexpr auto texture_index(GLenum target) -> size_t {
+        switch (target) {
+            case GL_TEXTURE_2D:
+                return 0;
+            case GL_TEXTURE_2D_ARRAY:
+                return 1;
+            case GL_TEXTURE_EXTERNAL_OES:
+                return 2;
+            default:
+                return untracked;
+        }
+    }
+
+    // Records `value` and returns whether the GL call is needed.
+    auto update(GLuint& cached, GLuint value) -> bool {
+        if (cached == value) {
+            stats_.skipped++;
+            return false;
+        }
+        cached = value;
+        stats_.issued++;
+        return true;
+    }
+
+    static auto forget(GLuint& cached, GLuint name) -> void {
+        if (cached == name) {
+            cached = unknown;
+        }
+    }
+
+    // Bumped on every forget_*() of a shared object, on any thread.
+    static auto shared_generation() -> std::atomic<uint64_t>& {
+        static std::atomic<uint64_t> generation{0};
+        return generation;
+    }
+
+    static auto invalidate_shared() -> void {
+        shared_generation().fetch_add(1, std::memory_order_release);
+    }
+
+    auto sync_shared() -> void {
+        if (shared_generation().load(std::memory_order_acquire) !=
+            generation_) {
+            forget_shared();
+        }
+    }
+
+    auto note_buffer(GLenum target, GLuint buffer) -> void {
+        sync_shared();
+        if (auto index = buffer_index(target); index != untracked) {
+            buffers_[index] = buffer;
+        }
+    }
+
+    GLuint program_;
+    GLuint vertex_array_;
+    GLenum active_unit_;
+    std::array<GLuint, 4> buffers_;
+    std::array<std::array<GLuint, 3>, max_texture_units> textures_;
+    uint64_t generation_;
+    GLStateStats stats_{};
+};
+
+// State tracker for the context current on the calling thread.
+inline auto gl_state() -> GLState& {
+    thread_local GLState state;
+    return state;
+}
+
+inline auto has_gl_extension(std::string_view name) -> bool {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        auto const* extension = reinterpret_cast<char const*>(
+            glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension != nullptr && name == extension) {
+            return true;
+        }
+    }
+    return false;
+}
+
+};  // namespace renderer
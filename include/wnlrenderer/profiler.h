@@ -0,0 +1,402 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <glad/gles2.h>
+#include <wnlrenderer/gl_state.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Not in the generated glad header (GL_EXT_disjoint_timer_query).
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+namespace renderer {
+
+struct FrameCounters {
+    uint64_t draw_calls;
+    uint64_t bytes_uploaded;   // texture and buffer data handed to GL
+    uint64_t binds;            // binds that reached the driver, see GLState
+    uint64_t uniform_updates;  // glUniform* calls and uniform block writes
+};
+
+struct ProfileZone {
+    char const* name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds duration;
+};
+
+struct FrameProfile {
+    uint64_t frame;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds cpu_time;
+    // Sum of the GPU zones; empty when the frame had none or their results
+    // were lost (no timer queries, a disjoint event, or too late to read).
+    std::optional<std::chrono::nanoseconds> gpu_time;
+    FrameCounters counters;
+    std::vector<ProfileZone> cpu_zones;
+    // The GPU gives durations only, so these start where they were issued.
+    std::vector<ProfileZone> gpu_zones;
+};
+
+namespace detail {
+struct TimerQueryFunctions {
+    void(GLAD_API_PTR* get_query_object_ui64)(GLuint, GLenum, GLuint64*);
+};
+
+inline auto timer_query_functions() -> TimerQueryFunctions& {
+    static TimerQueryFunctions functions{};
+    return functions;
+}
+};  // namespace detail
+
+// Enables GPU zones when the driver has GL_EXT_disjoint_timer_query. Call
+// with the loader used for glad, with a context current.
+inline auto load_timer_query(GLADloadfunc load) -> bool {
+    if (!has_gl_extension("GL_EXT_disjoint_timer_query")) {
+        return false;
+    }
+    auto& functions                 = detail::timer_query_functions();
+    functions.get_query_object_ui64 = reinterpret_cast<  // NOLINT
+        decltype(functions.get_query_object_ui64)>(
+        load("glGetQueryObjectui64vEXT"));
+    return functions.get_query_object_ui64 != nullptr;
+}
+
+struct Profiler;
+
+namespace detail {
+inline auto active_profiler() -> Profiler*& {
+    thread_local Profiler* profiler = nullptr;
+    return profiler;
+}
+};  // namespace detail
+
+// Per-thread frame profiler. attach() it on a render thread, then bracket
+// each frame with begin_frame() and end_frame(); CpuZone, GpuZone and the
+// renderer's own counters report to it from then on. Without an attached
+// profiler all of them cost a thread-local load.
+//
+// GPU results are read back frames later and never waited for: a frame shows
+// up in frames() once its timer queries are available, or with no GPU time
+// once `latency` newer frames have ended without them.
+struct Profiler {
+    explicit Profiler(size_t history = 240, size_t latency = 4)
+        : history_(history), latency_(latency) {
+    }
+
+    ~Profiler() {
+        detach();
+        for (auto& pending : pending_) {
+            for (auto const& query : pending.queries) {
+                glDeleteQueries(1, &query.query);
+            }
+        }
+        if (!free_queries_.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(free_queries_.size()),
+                            free_queries_.data());
+        }
+    }
+
+    Profiler(Profiler const&)            = delete;
+    Profiler& operator=(Profiler const&) = delete;
+
+    auto attach() -> void {
+        detail::active_profiler() = this;
+    }
+
+    auto detach() -> void {
+        if (detail::active_profiler() == this) {
+            detail::active_profiler() = nullptr;
+        }
+    }
+
+    auto begin_frame() -> void {
+        collect();
+        current_       = {};
+        current_.frame = frame_++;
+        current_.start = std::chrono::steady_clock::now();
+        counters_      = {};
+        binds_         = gl_state().get_stats().issued;
+        in_frame_      = true;
+    }
+
+    auto end_frame() -> void {
+        if (!in_frame_) {
+            return;
+        }
+        in_frame_         = false;
+        current_.cpu_time = std::chrono::steady_clock::now() - current_.start;
+        current_.counters = counters_;
+        current_.counters.binds = gl_state().get_stats().issued - binds_;
+        pending_.push_back({std::move(current_), std::move(queries_)});
+        queries_.clear();
+        collect();
+    }
+
+    // Completed frames, oldest first.
+    auto frames() const noexcept -> std::deque<FrameProfile> const& {
+        return frames_;
+    }
+
+    auto latest() const noexcept -> FrameProfile const* {
+        return frames_.empty() ? nullptr : &frames_.back();
+    }
+
+    // Hands over the completed frames, e.g. to stream them somewhere.
+    auto take_frames() -> std::deque<FrameProfile> {
+        return std::exchange(frames_, {});
+    }
+
+    // Counters of the frame in progress, for the renderer's bookkeeping.
+    auto counters() noexcept -> FrameCounters* {
+        return in_frame_ ? &counters_ : nullptr;
+    }
+
+    auto add_cpu_zone(ProfileZone const& zone) -> void {
+        if (in_frame_) {
+            current_.cpu_zones.push_back(zone);
+        }
+    }
+
+    // Timer queries cannot nest, so neither can GPU zones: one begun inside
+    // another is not recorded.
+    auto begin_gpu_zone(char const* name) -> bool {
+        if (!in_frame_ || gpu_zone_open_ ||
+            detail::timer_query_functions().get_query_object_ui64 ==
+                nullptr) {
+            return false;
+        }
+        GLuint query = 0;
+        if (free_queries_.empty()) {
+            glGenQueries(1, &query);
+        } else {
+            query = free_queries_.back();
+            free_queries_.pop_back();
+        }
+        glBeginQuery(GL_TIME_ELAPSED_EXT, query);
+        queries_.push_back({query, name, std::chrono::steady_clock::now()});
+        gpu_zone_open_ = true;
+        return true;
+    }
+
+    auto end_gpu_zone() -> void {
+        glEndQuery(GL_TIME_ELAPSED_EXT);
+        gpu_zone_open_ = false;
+    }
+
+    // Chrome trace event JSON of the completed frames, for chrome://tracing
+    // or ui.perfetto.dev. CPU zones go on one track, GPU zones on another.
+    auto write_chrome_trace(std::ostream& out) const -> void {
+        auto epoch = frames_.empty() ? std::chrono::steady_clock::time_point{}
+                                     : frames_.front().start;
+        auto micros = [&](auto time) {
+            return std::chrono::duration<double, std::micro>(time).count();
+        };
+        std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+        auto it           = std::back_inserter(json);
+        fmt::format_to(it, R"({{"name":"thread_name","ph":"M","pid":1,)"
+                           R"("tid":1,"args":{{"name":"CPU"}}}},)");
+        fmt::format_to(it, R"({{"name":"thread_name","ph":"M","pid":1,)"
+                           R"("tid":2,"args":{{"name":"GPU"}}}})");
+        auto event = [&](char const* name, auto start, auto duration,
+                         int tid) {
+            fmt::format_to(it,
+                           R"(,{{"name":"{}","ph":"X","pid":1,"tid":{},)"
+                           R"("ts":{:.3f},"dur":{:.3f}}})",
+                           name, tid, micros(start - epoch), micros(duration));
+        };
+        for (auto const& frame : frames_) {
+            auto name = fmt::format("frame {}", frame.frame);
+            event(name.c_str(), frame.start, frame.cpu_time, 1);
+            for (auto const& zone : frame.cpu_zones) {
+                event(zone.name, zone.start, zone.duration, 1);
+            }
+            for (auto const& zone : frame.gpu_zones) {
+                event(zone.name, zone.start, zone.duration, 2);
+            }
+            auto const& counters = frame.counters;
+            fmt::format_to(it,
+                           R"(,{{"name":"counters","ph":"C","pid":1,)"
+                           R"("ts":{:.3f},"args":{{"draw_calls":{},)"
+                           R"("bytes_uploaded":{},"binds":{},)"
+                           R"("uniform_updates":{}}}}})",
+                           micros(frame.start - epoch), counters.draw_calls,
+                           counters.bytes_uploaded, counters.binds,
+                           counters.uniform_updates);
+        }
+        json += "]}\n";
+        out << json;
+    }
+
+private:
+    struct Query {
+        GLuint query;
+        char const* name;
+        std::chrono::steady_clock::time_point issued;
+    };
+
+    struct PendingFrame {
+        FrameProfile profile;
+        std::vector<Query> queries;
+    };
+
+    // Moves frames whose GPU results are in, or overdue, to frames_.
+    auto collect() -> void {
+        bool disjoint = false;
+        if (!pending_.empty() &&
+            detail::timer_query_functions().get_query_object_ui64 !=
+                nullptr) {
+            // Reading clears it; a set flag voids every result in flight.
+            GLint flag = 0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &flag);
+            disjoint = flag != 0;
+        }
+        while (!pending_.empty()) {
+            auto& pending = pending_.front();
+            bool available = true;
+            if (!pending.queries.empty()) {
+                // Queries finish in order, so the last one speaks for all.
+                GLuint ready = 0;
+                glGetQueryObjectuiv(pending.queries.back().query,
+                                    GL_QUERY_RESULT_AVAILABLE, &ready);
+                available = ready != 0;
+            }
+            if (!available && !disjoint && pending_.size() <= latency_) {
+                break;
+            }
+            complete(pending, available && !disjoint);
+            pending_.pop_front();
+        }
+    }
+
+    auto complete(PendingFrame& pending, bool results) -> void {
+        auto& profile = pending.profile;
+        if (results && !pending.queries.empty()) {
+            std::chrono::nanoseconds total{};
+            for (auto const& query : pending.queries) {
+                GLuint64 elapsed = 0;
+                detail::timer_query_functions().get_query_object_ui64(
+                    query.query, GL_QUERY_RESULT, &elapsed);
+                std::chrono::nanoseconds duration{elapsed};
+                profile.gpu_zones.push_back(
+                    {query.name, query.issued, duration});
+                total += duration;
+            }
+            profile.gpu_time = total;
+        }
+        for (auto const& query : pending.queries) {
+            if (results) {
+                free_queries_.push_back(query.query);
+            } else {
+                // May still be in flight; let the driver retire it.
+                glDeleteQueries(1, &query.query);
+            }
+        }
+        frames_.push_back(std::move(profile));
+        while (frames_.size() > history_) {
+            frames_.pop_front();
+        }
+    }
+
+    size_t history_;
+    size_t latency_;
+    uint64_t frame_{};
+    bool in_frame_{};
+    bool gpu_zone_open_{};
+    FrameProfile current_{};
+    FrameCounters counters_{};
+    uint64_t binds_{};
+    std::vector<Query> queries_;
+    std::deque<PendingFrame> pending_;
+    std::deque<FrameProfile> frames_;
+    std::vector<GLuint> free_queries_;
+};
+
+// Times the enclosing scope into the profiler attached to this thread.
+// `name` is kept as a pointer, so pass a string literal.
+struct CpuZone {
+    explicit CpuZone(char const* name)
+        : profiler_(detail::active_profiler()), name_(name) {
+        if (profiler_ != nullptr) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~CpuZone() {
+        if (profiler_ != nullptr) {
+            profiler_->add_cpu_zone(
+                {name_, start_, std::chrono::steady_clock::now() - start_});
+        }
+    }
+
+    CpuZone(CpuZone const&)            = delete;
+    CpuZone& operator=(CpuZone const&) = delete;
+
+private:
+    Profiler* profiler_;
+    char const* name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Times the GL commands issued in the enclosing scope on the GPU.
+struct GpuZone {
+    explicit GpuZone(char const* name)
+        : profiler_(detail::active_profiler()) {
+        if (profiler_ != nullptr && !profiler_->begin_gpu_zone(name)) {
+            profiler_ = nullptr;
+        }
+    }
+
+    ~GpuZone() {
+        if (profiler_ != nullptr) {
+            profiler_->end_gpu_zone();
+        }
+    }
+
+    GpuZone(GpuZone const&)            = delete;
+    GpuZone& operator=(GpuZone const&) = delete;
+
+private:
+    Profiler* profiler_;
+};
+
+namespace detail {
+inline auto count_draw_call() -> void {
+    if (auto* profiler = active_profiler(); profiler != nullptr) {
+        if (auto* counters = profiler->counters(); counters != nullptr) {
+            counters->draw_calls++;
+        }
+    }
+}
+
+inline auto count_upload(size_t bytes) -> void {
+    if (auto* profiler = active_profiler(); profiler != nullptr) {
+        if (auto* counters = profiler->counters(); counters != nullptr) {
+            counters->bytes_uploaded += bytes;
+        }
+    }
+}
+
+inline auto count_uniform_updates(size_t count = 1) -> void {
+    if (auto* profiler = active_profiler(); profiler != nullptr) {
+        if (auto* counters = profiler->counters(); counters != nullptr) {
+            counters->uniform_updates += count;
+        }
+    }
+}
+};  // namespace detail
+
+};  // namespace renderer
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <wnlrenderer/command_buffer.h>
+#include <wnlrenderer/renderer.h>
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+// 32-bit reference into a ResourceRegistry: a slot index and the generation
+// of the slot when the handle was made. Removing a resource bumps its
+// slot's generation, so older handles to it stop resolving instead of
+// aliasing whatever reuses the slot. The zero handle is null.
+template <typename Tag>
+struct Handle {
+    static constexpr uint32_t index_bits     = 20;
+    static constexpr uint32_t index_mask     = (1U << index_bits) - 1;
+    static constexpr uint32_t max_generation = ~uint32_t{0} >> index_bits;
+
+    uint32_t value;
+
+    constexpr auto get_index() const noexcept -> uint32_t {
+        return value & index_mask;
+    }
+
+    constexpr auto get_generation() const noexcept -> uint32_t {
+        return value >> index_bits;
+    }
+
+    constexpr explicit operator bool() const noexcept {
+        return value != 0;
+    }
+
+    auto operator==(Handle const&) const -> bool = default;
+};
+
+using MeshHandle    = Handle<struct MeshTag>;
+using TextureHandle = Handle<struct TextureTag>;
+using SpriteHandle  = Handle<struct SpriteTag>;
+
+// What binding a registered texture takes: up to three names on units 0 to 2,
+// all on one target.
+struct TextureBinding {
+    GLenum target;
+    std::array<GLuint, 3> textures;
+};
+
+// Sprite drawn through a ResourceRegistry. Plain data with no refcounts, so
+// thousands of them stay packed in a vector and can be copied between
+// threads freely; the registry keeps what they point to alive. To batch or
+// damage-track one, keep it in the registry too (add_sprite()).
+struct Sprite {
+    MeshHandle mesh;
+    TextureHandle texture;
+    float layer;  // texture array layer
+    glm::vec3 position;
+    glm::vec2 scale;
+    bool opaque;  // hides what it covers, see BatchRenderer::cull()
+
+    auto operator==(Sprite const&) const -> bool = default;
+};
+
+static_assert(std::is_trivially_copyable_v<Sprite>);
+
+// What BatchRenderer and DamageTracker recognise from one frame to the next:
+// a Renderable by its address, a Sprite by its registry and handle, so the
+// sprite itself may be copied or moved.
+struct SourceId {
+    void const* owner;
+    uint32_t sprite;  // 0 for a Renderable
+
+    auto operator<=>(SourceId const&) const = default;
+};
+
+namespace detail {
+// Records in dense arrays, indexed by handle, with their owners kept apart so
+// a traversal only touches the records.
+template <typename Tag, typename Record>
+struct SlotMap {
+    using Key = Handle<Tag>;
+
+    auto add(Record const& record, std::shared_ptr<void> owner) -> Key {
+        uint32_t index = 0;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            if (records_.size() > Key::index_mask) {
+                throw std::runtime_error(fmt::format(
+                    "Registry is limited to {} entries", Key::index_mask + 1));
+            }
+            index = static_cast<uint32_t>(records_.size());
+            records_.emplace_back();
+            generations_.push_back(1);
+            owners_.emplace_back();
+        }
+        records_[index] = record;
+        owners_[index]  = std::move(owner);
+        return {(generations_[index] << Key::index_bits) | index};
+    }
+
+    auto remove(Key key) -> void {
+        if (find(key) == nullptr) {
+            return;
+        }
+        auto index = key.get_index();
+        owners_[index].reset();
+        auto& generation = generations_[index];
+        generation = generation == Key::max_generation ? 1 : generation + 1;
+        free_.push_back(index);
+    }
+
+    // Null for a null, removed or foreign handle.
+    auto find(Key key) const noexcept -> Record const* {
+        auto index = key.get_index();
+        if (index >= records_.size() ||
+            generations_[index] != key.get_generation()) {
+            return nullptr;
+        }
+        return &records_[index];
+    }
+
+    auto get(Key key) const -> Record const& {
+        auto const* record = find(key);
+        if (record == nullptr) {
+            throw std::runtime_error(
+                fmt::format("Stale or invalid handle {:#x}", key.value));
+        }
+        return *record;
+    }
+
+    auto get(Key key) -> Record& {
+        return const_cast<Record&>(std::as_const(*this).get(key));  // NOLINT
+    }
+
+    auto size() const noexcept -> size_t {
+        return records_.size() - free_.size();
+    }
+
+private:
+    std::vector<Record> records_;
+    std::vector<uint32_t> generations_;
+    std::vector<std::shared_ptr<void>> owners_;
+    std::vector<uint32_t> free_;
+};
+};  // namespace detail
+
+// Owns meshes and textures on behalf of Sprites and resolves their handles
+// to GL names, so drawing a sprite chases one array index per resource
+// instead of several shared_ptrs. Registering takes one reference that is
+// held until remove(); sprites do not count.
+//
+// Not thread-safe: register and remove on one thread, or lock around it.
+struct ResourceRegistry {
+    auto add_mesh(std::shared_ptr<Mesh> mesh) -> MeshHandle {
+        auto* record = mesh.get();
+        return meshes_.add(record, std::move(mesh));
+    }
+
+    template <int format>
+    auto add_texture(std::shared_ptr<Texture<format>> texture)
+        -> TextureHandle {
+        TextureBinding binding{GL_TEXTURE_2D, {texture->get_id(), 0, 0}};
+        return add_texture(binding, std::move(texture));
+    }
+
+    template <int format>
+    auto add_texture(std::shared_ptr<TextureArray<format>> texture)
+        -> TextureHandle {
+        TextureBinding binding{GL_TEXTURE_2D_ARRAY,
+                               {texture->get_id(), 0, 0}};
+        return add_texture(binding, std::move(texture));
+    }
+
+    auto add_texture(std::shared_ptr<YuvTexture> texture) -> TextureHandle {
+        return add_texture(binding_of(GL_TEXTURE_2D, texture->get_planes()),
+                           std::move(texture));
+    }
+
+#ifdef WNLRENDERER_EGL
+    auto add_texture(std::shared_ptr<ExternalTexture> texture)
+        -> TextureHandle {
+        return add_texture(
+            binding_of(texture->get_target(), texture->get_planes()),
+            std::move(texture));
+    }
+#endif
+
+    // A sprite kept here is known by its handle, which BatchRenderer and
+    // DamageTracker use to recognise it between frames. Edit it through
+    // get_sprite().
+    auto add_sprite(Sprite const& sprite) -> SpriteHandle {
+        return sprites_.add(sprite, nullptr);
+    }
+
+    auto remove(MeshHandle mesh) -> void {
+        meshes_.remove(mesh);
+    }
+
+    auto remove(TextureHandle texture) -> void {
+        textures_.remove(texture);
+    }
+
+    auto remove(SpriteHandle sprite) -> void {
+        sprites_.remove(sprite);
+    }
+
+    auto get_mesh(MeshHandle mesh) const -> Mesh& {
+        return *meshes_.get(mesh);
+    }
+
+    auto get_sprite(SpriteHandle sprite) const -> Sprite const& {
+        return sprites_.get(sprite);
+    }
+
+    auto get_sprite(SpriteHandle sprite) -> Sprite& {
+        return sprites_.get(sprite);
+    }
+
+    auto get_binding(TextureHandle texture) const -> TextureBinding const& {
+        return textures_.get(texture).binding;
+    }
+
+    // The texture's get_revision(), which changes with its contents.
+    auto get_revision(TextureHandle texture) const -> uint64_t {
+        auto const& record = textures_.get(texture);
+        return record.revision(record.texture);
+    }
+
+    auto is_valid(MeshHandle mesh) const noexcept -> bool {
+        return meshes_.find(mesh) != nullptr;
+    }
+
+    auto is_valid(TextureHandle texture) const noexcept -> bool {
+        return textures_.find(texture) != nullptr;
+    }
+
+    auto is_valid(SpriteHandle sprite) const noexcept -> bool {
+        return sprites_.find(sprite) != nullptr;
+    }
+
+    // Draws with the sprite's transform in u_Transform. Throws on a stale
+    // handle.
+    auto draw(ShaderProgram const& program, Sprite const& sprite) const
+        -> void {
+        auto packet = make_packet(program, sprite);
+        program.use();
+        bind_textures(packet);
+        program.set<"u_Transform">(packet.transform);
+        packet.mesh->draw();
+    }
+
+    auto draw(ShaderProgram const& program,
+              std::span<Sprite const> sprites) const -> void {
+        for (auto const& sprite : sprites) {
+            draw(program, sprite);
+        }
+    }
+
+    // For recording into a CommandBuffer instead of drawing right away.
+    auto make_packet(ShaderProgram const& program, Sprite const& sprite) const
+        -> DrawPacket {
+        auto const& binding = get_binding(sprite.texture);
+        return {
+            .program        = &program,
+            .mesh           = &get_mesh(sprite.mesh),
+            .texture_target = binding.target,
+            .textures       = binding.textures,
+            .layer          = sprite.layer,
+            .transform      = compose_2d(sprite.position, sprite.scale),
+        };
+    }
+
+private:
+    struct TextureRecord {
+        TextureBinding binding;
+        void const* texture;
+        uint64_t (*revision)(void const*);
+    };
+
+    template <typename T>
+    auto add_texture(TextureBinding const& binding, std::shared_ptr<T> texture)
+        -> TextureHandle {
+        TextureRecord record{
+            binding, texture.get(), [](void const* source) {
+                return static_cast<T const*>(source)->get_revision();
+            }};
+        return textures_.add(record, std::move(texture));
+    }
+
+    template <typename Plane>
+    static auto binding_of(GLenum target, std::span<Plane const> planes)
+        -> TextureBinding {
+        TextureBinding binding{target, {}};
+        for (size_t i = 0; i < planes.size() && i < binding.textures.size();
+             i++) {
+            binding.textures[i] = planes[i].texture;
+        }
+        return binding;
+    }
+
+    detail::SlotMap<MeshTag, Mesh*> meshes_;
+    detail::SlotMap<TextureTag, TextureRecord> textures_;
+    detail::SlotMap<SpriteTag, Sprite> sprites_;
+};
+
+};  // namespace renderer
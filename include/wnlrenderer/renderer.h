@@ -2,20 +2,46 @@
 
 #include <fmt/format.h>
 #include <glad/gles2.h>
-
+#include <wnlrenderer/gl_state.h>
+#include <wnlrenderer/profiler.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
+#include <optional>
+#include <random>
 #include <span>
+#include <type_traits>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <variant>
 #include <vector>
 
+// Not in the generated glad header (GL_KHR_parallel_shader_compile).
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace {
-inline auto LoadShader(GLenum type, std::string const& shaderSrc) -> GLuint {
+// Only starts the compile: its status is read once the program has linked,
+// so a driver compiling in parallel is not made to finish in between.
+inline auto CompileShader(GLenum type, std::string const& shaderSrc)
+    -> GLuint {
     GLuint shader = glCreateShader(type);
     if (shader == 0) {
         throw std::runtime_error("failed to allocate shader");
@@ -23,130 +49,892 @@ inline auto LoadShader(GLenum type, std::string const& shaderSrc) -> GLuint {
     auto const* data = shaderSrc.data();
     glShaderSource(shader, 1, &data, nullptr);
     glCompileShader(shader);
+    return shader;
+}
 
+// Why `shader` failed to compile; empty if it compiled.
+inline auto ShaderError(GLuint shader, GLenum type) -> std::string {
     GLint compiled;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if (compiled == 0) {
-        GLint infoLen = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
-        if (infoLen > 1) {
-            std::string infoLog;
-            infoLog.resize(infoLen);
-            glGetShaderInfoLog(shader, infoLen, nullptr, infoLog.data());
-            glDeleteShader(shader);
-            throw std::runtime_error(fmt::format(
-                "Error compiling shader {}\n:{}",
-                type == GL_VERTEX_SHADER ? "Vertex Shader" : "Fragment Shader",
-                infoLog));
-        }
-        glDeleteShader(shader);
-        throw std::runtime_error("Error compiling shader");
+    if (compiled != 0) {
+        return {};
     }
-    return shader;
+    GLint infoLen = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+    if (infoLen <= 1) {
+        return "Error compiling shader";
+    }
+    std::string infoLog;
+    infoLog.resize(infoLen);
+    glGetShaderInfoLog(shader, infoLen, nullptr, infoLog.data());
+    return fmt::format(
+        "Error compiling shader {}\n:{}",
+        type == GL_VERTEX_SHADER ? "Vertex Shader" : "Fragment Shader",
+        infoLog);
+}
+
+inline auto ProgramError(GLuint program) -> std::string {
+    GLint infoLen = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
+    if (infoLen <= 1) {
+        return "Error linking shader program";
+    }
+    std::string infoLog;
+    infoLog.resize(infoLen);
+    glGetProgramInfoLog(program, infoLen, nullptr, infoLog.data());
+    return fmt::format("Error linking shader program:\n:{}", infoLog);
 }
 };  // namespace
 
 namespace renderer {
 
-struct ShaderProgram {
-    ShaderProgram(const std::string& vertex_shader,
-                  const std::string& fragment_shader) {
-        GLuint vertexShader   = LoadShader(GL_VERTEX_SHADER, vertex_shader);
-        GLuint fragmentShader = LoadShader(GL_FRAGMENT_SHADER, fragment_shader);
+// Attribute locations every ShaderProgram is linked with, matching the order
+// in which Vertex::getLayout() and the batch renderer feed them.
+namespace attribute {
+constexpr GLuint position  = 0;
+constexpr GLuint tex_coord = 1;
+constexpr GLuint transform = 2;  // mat4, occupies four consecutive locations
+constexpr GLuint layer     = 6;  // texture array layer, see TextureArray
+};  // namespace attribute
+
+// std140 blocks the renderer knows by name. Programs declaring them get them
+// bound to these binding points at link time:
+//
+//   uniform FrameUniforms { mat4 u_Projection; };
+//   uniform DrawUniforms { mat4 u_Transform; };
+struct FrameUniforms {
+    glm::mat4 projection;
+};
 
-        shaderProgram_ = glCreateProgram();
-        if (shaderProgram_ == 0) {
-            throw std::runtime_error("Failed to allocate shader program");
+struct DrawUniforms {
+    glm::mat4 transform;
+};
+
+namespace uniform_block {
+constexpr GLuint frame = 0;
+constexpr GLuint draw  = 1;
+};  // namespace uniform_block
+
+// Texture units the samplers the renderer knows by name are pinned to at link
+// time. Renderable::bind_textures() binds its textures to the same units.
+constexpr std::array<std::pair<char const*, GLint>, 5> sampler_units{{
+    {"u_texture", 0},
+    {"u_texture_y", 0},
+    {"u_texture_u", 1},
+    {"u_texture_v", 2},
+    {"u_texture_uv", 1},
+}};
+
+// String literal usable as a template argument, e.g. set<"u_Transform">().
+template <size_t N>
+struct FixedString {
+    constexpr FixedString(char const (&str)[N]) {  // NOLINT
+        std::copy_n(str, N, value);
+    }
+
+    constexpr auto c_str() const -> char const* {
+        return value;
+    }
+
+    char value[N]{};  // NOLINT
+};
+
+template <typename T>
+struct UniformHandle {
+    GLint location = -1;
+};
+
+namespace detail {
+inline auto next_uniform_slot() -> size_t {
+    static std::atomic<size_t> next{0};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Process-wide index for a compile-time uniform name; every ShaderProgram
+// caches that name's location at this index. Handed out on first use, so
+// whichever translation unit asks first, the slot is set by then.
+template <FixedString name>
+auto uniform_slot() -> size_t {
+    static size_t const slot = next_uniform_slot();
+    return slot;
+}
+
+struct StringHash {
+    using is_transparent = void;
+
+    auto operator()(std::string_view str) const noexcept -> size_t {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+};  // namespace detail
+
+namespace detail {
+// 64-bit FNV-1a, chained through `hash`. The length goes in too, so "ab", "c"
+// and "a", "bc" hash differently.
+constexpr auto hash_string(std::string_view str,
+                           uint64_t hash = 0xcbf29ce484222325ULL) -> uint64_t {
+    for (auto ch : str) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3ULL;
+    }
+    return (hash ^ str.size()) * 0x100000001b3ULL;
+}
+
+// Set once the driver is known to answer GL_COMPLETION_STATUS_KHR.
+inline auto parallel_shader_compile() -> std::atomic<bool>& {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
+
+inline auto gl_string(GLenum name) -> std::string_view {
+    auto const* str = reinterpret_cast<char const*>(glGetString(name));
+    return str != nullptr ? str : "";
+}
+};  // namespace detail
+
+// Lets the driver compile shaders on threads of its own when it has
+// GL_KHR_parallel_shader_compile; compiles then only block once a status is
+// queried, which ShaderProgram::build_all() puts off until all have started.
+// Call with the loader used for glad, with a context current. Returns false
+// without the extension.
+inline auto enable_parallel_shader_compile(GLADloadfunc load) -> bool {
+    if (!has_gl_extension("GL_KHR_parallel_shader_compile")) {
+        return false;
+    }
+    auto max_threads = reinterpret_cast<  // NOLINT
+        void(GLAD_API_PTR*)(GLuint)>(load("glMaxShaderCompilerThreadsKHR"));
+    if (max_threads == nullptr) {
+        return false;
+    }
+    max_threads(0xFFFFFFFFU);  // as many as the driver sees fit
+    detail::parallel_shader_compile().store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// On-disk cache of linked program binaries. Entries are keyed by the shader
+// sources and GL_VENDOR, GL_RENDERER and GL_VERSION, which carries the driver
+// version, so an updated driver misses rather than being handed a binary it
+// would reject. Nothing here ever fails loudly: a missing, stale or
+// unwritable entry just means compiling from source.
+//
+// Construct it with a context current. It can be shared by every
+// ShaderProgram of a process, as long as they are built on one thread at a
+// time.
+struct ProgramBinaryCache {
+    explicit ProgramBinaryCache(std::filesystem::path directory)
+        : directory_(std::move(directory)) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        enabled_ = formats > 0 && !error;
+        for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            driver_ = detail::hash_string(detail::gl_string(name), driver_);
         }
-        glAttachShader(shaderProgram_, vertexShader);
-        glAttachShader(shaderProgram_, fragmentShader);
-        glLinkProgram(shaderProgram_);
+    }
 
-        glDetachShader(shaderProgram_, vertexShader);
-        glDetachShader(shaderProgram_, fragmentShader);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+    auto is_enabled() const noexcept -> bool {
+        return enabled_;
+    }
 
-        GLint linked;
-        glGetProgramiv(shaderProgram_, GL_LINK_STATUS, &linked);
-        if (linked == 0) {
-            GLint infoLen = 0;
-            glGetProgramiv(shaderProgram_, GL_INFO_LOG_LENGTH, &infoLen);
-            if (infoLen > 1) {
-                std::string infoLog;
-                infoLog.resize(infoLen);
-                glGetProgramInfoLog(shaderProgram_, infoLen, nullptr,
-                                    infoLog.data());
-                glDeleteProgram(shaderProgram_);
-                throw std::runtime_error(
-                    fmt::format("Error linking shader program:\n:{}", infoLog));
+    auto key(std::string_view vertex_shader,
+             std::string_view fragment_shader) const -> uint64_t {
+        return detail::hash_string(fragment_shader,
+                                   detail::hash_string(vertex_shader, driver_));
+    }
+
+    // Hands the binary stored under `key` to `program`, returning whether
+    // there was one. Whether the driver took it shows in GL_LINK_STATUS.
+    auto load(uint64_t key, GLuint program) const -> bool {
+        if (!enabled_) {
+            return false;
+        }
+        std::ifstream file{path(key), std::ios::binary};
+        Header header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            header.magic != magic || header.length == 0) {
+            return false;
+        }
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), static_cast<std::streamsize>(
+                                          binary.size()))) {
+            return false;
+        }
+        glProgramBinary(program, header.format, binary.data(),
+                        static_cast<GLsizei>(binary.size()));
+        return true;
+    }
+
+    // Saves the binary of the linked `program`. The entry is written aside
+    // and renamed into place, so other processes never read half of one.
+    auto store(uint64_t key, GLuint program) const -> void {
+        if (!enabled_) {
+            return;
+        }
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+        std::vector<char> binary(static_cast<size_t>(length));
+        Header header{magic, 0, 0};
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &header.format,
+                           binary.data());
+        if (written <= 0) {
+            return;
+        }
+        header.length = static_cast<uint32_t>(written);
+
+        auto target    = path(key);
+        auto temporary = target;
+        temporary += fmt::format(".{:08x}", std::random_device{}());
+        std::error_code error;
+        {
+            std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+            file.write(binary.data(), written);
+            if (!file) {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return;
             }
-            glDeleteProgram(shaderProgram_);
-            throw std::runtime_error("Error linking shader program");
         }
+        std::filesystem::rename(temporary, target, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+        }
+    }
+
+    // Drops an entry the driver rejected.
+    auto forget(uint64_t key) const -> void {
+        std::error_code error;
+        std::filesystem::remove(path(key), error);
+    }
+
+private:
+    struct Header {
+        uint32_t magic;
+        GLenum format;
+        uint32_t length;
+    };
+
+    static constexpr uint32_t magic = 0x424c4e57;  // "WNLB"
+
+    auto path(uint64_t key) const -> std::filesystem::path {
+        return directory_ / fmt::format("{:016x}.bin", key);
+    }
+
+    std::filesystem::path directory_;
+    uint64_t driver_{detail::hash_string({})};
+    bool enabled_{};
+};
+
+struct ShaderSource {
+    std::string vertex;
+    std::string fragment;
+};
+
+// A program can be used from every context of a share group, but its
+// uniforms are program state: when several threads render with one program,
+// pass per-context values such as the projection through uniform blocks.
+struct ShaderProgram {
+    // With a `cache`, a binary stored by an earlier run replaces compiling
+    // and linking, and a freshly linked program is stored for the next one.
+    ShaderProgram(const std::string& vertex_shader,
+                  const std::string& fragment_shader,
+                  ProgramBinaryCache const* cache = nullptr)
+        : ShaderProgram() {
+        begin_link(vertex_shader, fragment_shader, cache);
+        finish_link();
+    }
+
+    // Starts building the program and returns at once. Poll is_ready(), or
+    // wait(), before using it.
+    static auto deferred(std::string vertex_shader,
+                         std::string fragment_shader,
+                         ProgramBinaryCache const* cache = nullptr)
+        -> ShaderProgram {
+        return {Deferred{},
+                ShaderSource{std::move(vertex_shader),
+                             std::move(fragment_shader)},
+                cache};
+    }
+
+    // Starts every compile and link before waiting on any, which lets a
+    // driver with enable_parallel_shader_compile() build them concurrently.
+    static auto build_all(std::span<ShaderSource const> sources,
+                          ProgramBinaryCache const* cache = nullptr)
+        -> std::vector<ShaderProgram> {
+        std::vector<ShaderProgram> programs;
+        programs.reserve(sources.size());
+        for (auto const& source : sources) {
+            programs.push_back(ShaderProgram{Deferred{}, source, cache});
+        }
+        for (auto& program : programs) {
+            program.finish_link();
+        }
+        return programs;
     }
 
     ShaderProgram(ShaderProgram const&)            = delete;
     ShaderProgram& operator=(ShaderProgram const&) = delete;
 
     ShaderProgram(ShaderProgram&& other) noexcept
-        : shaderProgram_(std::exchange(other.shaderProgram_, 0)) {
+        : shaderProgram_(std::exchange(other.shaderProgram_, 0))
+        , m_UniformLocationCache(std::move(other.m_UniformLocationCache))
+        , m_AttributeLocationCache(std::move(other.m_AttributeLocationCache))
+        , m_FixedLocationCache(std::move(other.m_FixedLocationCache))
+        , pending_(std::move(other.pending_)) {
     }
 
     ShaderProgram& operator=(ShaderProgram&& other) noexcept {
         std::ranges::swap(other.shaderProgram_, shaderProgram_);
+        std::ranges::swap(other.m_UniformLocationCache, m_UniformLocationCache);
+        std::ranges::swap(other.m_AttributeLocationCache,
+                          m_AttributeLocationCache);
+        std::ranges::swap(other.m_FixedLocationCache, m_FixedLocationCache);
+        std::ranges::swap(other.pending_, pending_);
         return *this;
     }
 
     ~ShaderProgram() {
+        if (pending_) {
+            glDeleteShader(pending_->vertex_shader);
+            glDeleteShader(pending_->fragment_shader);
+        }
+        gl_state().forget_program(shaderProgram_);
         glDeleteProgram(shaderProgram_);
     }
 
+    // Whether the program can be used. Never blocks once
+    // enable_parallel_shader_compile() has succeeded; without it the first
+    // call waits for the link. Throws like the constructor if building
+    // failed.
+    auto is_ready() -> bool {
+        if (!pending_) {
+            return true;
+        }
+        if (detail::parallel_shader_compile().load(std::memory_order_relaxed)) {
+            GLint done = 0;
+            glGetProgramiv(shaderProgram_, GL_COMPLETION_STATUS_KHR, &done);
+            if (done == 0 || relink_if_rejected()) {
+                return false;
+            }
+        }
+        finish_link();
+        return true;
+    }
+
+    auto wait() -> void {
+        if (pending_) {
+            finish_link();
+        }
+    }
+
     auto use() const -> void {
-        glUseProgram(shaderProgram_);
+        gl_state().use_program(shaderProgram_);
     }
 
-    auto set_int(std::string const& name, int value) const -> void {
-        glUniform1i(get_uniform_location(name), value);
+    auto get_id() const noexcept -> GLuint {
+        return shaderProgram_;
     }
 
-    auto set_int(char const* name, int value) const -> void {
+    // Assigns the named uniform block to `binding`; a no-op if the program
+    // does not declare it.
+    auto bind_uniform_block(char const* name, GLuint binding) const -> void {
+        GLuint index = glGetUniformBlockIndex(shaderProgram_, name);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shaderProgram_, index, binding);
+        }
+    }
+
+    auto set_int(std::string_view name, int value) const -> void {
         glUniform1i(get_uniform_location(name), value);
+        detail::count_uniform_updates();
     }
 
-    auto set_mat4(std::string const& name, glm::mat4 value) const -> void {
+    auto set_mat4(std::string_view name, glm::mat4 value) const -> void {
         glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE,
                            glm::value_ptr(value));
+        detail::count_uniform_updates();
     }
 
-    auto set_mat4(char const* name, glm::mat4 value) const -> void {
-        glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE,
+    // Resolves a uniform once so later updates skip the name lookup.
+    template <typename T>
+    auto get_uniform(std::string_view name) const -> UniformHandle<T> {
+        return {get_uniform_location(name)};
+    }
+
+    auto set(UniformHandle<int> uniform, int value) const -> void {
+        glUniform1i(uniform.location, value);
+        detail::count_uniform_updates();
+    }
+
+    auto set(UniformHandle<float> uniform, float value) const -> void {
+        glUniform1f(uniform.location, value);
+        detail::count_uniform_updates();
+    }
+
+    auto set(UniformHandle<glm::mat4> uniform, glm::mat4 const& value) const
+        -> void {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE,
                            glm::value_ptr(value));
+        detail::count_uniform_updates();
+    }
+
+    // Sets a uniform named at compile time; its location is cached in a slot
+    // indexed by the name, so no hashing happens after the first call.
+    template <FixedString name, typename T>
+    auto set(T const& value) const -> void {
+        set(UniformHandle<T>{get_uniform_location<name>()}, value);
     }
 
-    GLint get_attrib_location(std::string const& name) const {
-        if (m_AttributeLocationCache.contains(name)) {
-            return m_AttributeLocationCache.at(name);
+    // Safe to call from several threads at once: the slots are filled from
+    // the locations read at link time, and racing fills store the same value.
+    template <FixedString name>
+    auto get_uniform_location() const -> GLint {
+        auto slot = detail::uniform_slot<name>();
+        if (slot >= fixed_slots || !m_FixedLocationCache) {
+            return get_uniform_location(name.c_str());
+        }
+        auto& cached  = m_FixedLocationCache[slot];
+        auto location = cached.load(std::memory_order_relaxed);
+        if (location == unresolved_location) {
+            location = get_uniform_location(name.c_str());
+            cached.store(location, std::memory_order_relaxed);
         }
-        GLint location = glGetAttribLocation(shaderProgram_, name.c_str());
-        m_AttributeLocationCache[name] = location;
         return location;
     }
 
+    GLint get_attrib_location(std::string_view name) const {
+        auto it = m_AttributeLocationCache.find(name);
+        return it != m_AttributeLocationCache.end() ? it->second : -1;
+    }
+
 private:
-    GLint get_uniform_location(std::string const& name) const {
-        if (m_UniformLocationCache.contains(name)) {
-            return m_UniformLocationCache.at(name);
+    static constexpr GLint unresolved_location = -2;
+    // Names past this many fall back to the hashed lookup.
+    static constexpr size_t fixed_slots = 64;
+
+    struct Deferred {};
+
+    // What a link in flight needs until finish_link().
+    struct PendingLink {
+        std::string vertex_source;
+        std::string fragment_source;
+        ProgramBinaryCache const* cache;
+        uint64_t key;
+        bool from_binary;
+        GLuint vertex_shader;
+        GLuint fragment_shader;
+    };
+
+    // Owns nothing yet. Delegated to first, so a link that throws half way
+    // is cleaned up by the destructor.
+    ShaderProgram() = default;
+
+    ShaderProgram(Deferred, ShaderSource const& source,
+                  ProgramBinaryCache const* cache)
+        : ShaderProgram() {
+        begin_link(source.vertex, source.fragment, cache);
+    }
+
+    auto begin_link(std::string vertex_shader,
+                    std::string fragment_shader,
+                    ProgramBinaryCache const* cache) -> void {
+        shaderProgram_ = glCreateProgram();
+        if (shaderProgram_ == 0) {
+            throw std::runtime_error("Failed to allocate shader program");
         }
-        GLint location = glGetUniformLocation(shaderProgram_, name.c_str());
-        m_UniformLocationCache[name] = location;
-        return location;
+        pending_ = std::make_unique<PendingLink>(
+            PendingLink{std::move(vertex_shader), std::move(fragment_shader),
+                        cache, 0, false, 0, 0});
+        if (cache != nullptr && cache->is_enabled()) {
+            pending_->key = cache->key(pending_->vertex_source,
+                                       pending_->fragment_source);
+            pending_->from_binary = cache->load(pending_->key, shaderProgram_);
+        }
+        if (!pending_->from_binary) {
+            link_from_source();
+        }
+    }
+
+    auto link_from_source() -> void {
+        auto& pending = *pending_;
+        pending.vertex_shader =
+            CompileShader(GL_VERTEX_SHADER, pending.vertex_source);
+        pending.fragment_shader =
+            CompileShader(GL_FRAGMENT_SHADER, pending.fragment_source);
+
+        glAttachShader(shaderProgram_, pending.vertex_shader);
+        glAttachShader(shaderProgram_, pending.fragment_shader);
+        glBindAttribLocation(shaderProgram_, attribute::position, "a_position");
+        glBindAttribLocation(shaderProgram_, attribute::tex_coord,
+                             "a_texCoord");
+        glBindAttribLocation(shaderProgram_, attribute::transform,
+                             "a_transform");
+        glBindAttribLocation(shaderProgram_, attribute::layer, "a_layer");
+        if (pending.cache != nullptr) {
+            glProgramParameteri(shaderProgram_,
+                                GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(shaderProgram_);
+    }
+
+    // Starts over from source if the driver turned down a cached binary,
+    // e.g. after an update that kept its version string.
+    auto relink_if_rejected() -> bool {
+        if (!pending_->from_binary) {
+            return false;
+        }
+        GLint linked;
+        glGetProgramiv(shaderProgram_, GL_LINK_STATUS, &linked);
+        if (linked != 0) {
+            return false;
+        }
+        pending_->cache->forget(pending_->key);
+        pending_->from_binary = false;
+        link_from_source();
+        return true;
+    }
+
+    // Blocks until the link started by begin_link() is done, then sets up
+    // the program. Throws, with the program deleted, if it failed.
+    auto finish_link() -> void {
+        relink_if_rejected();
+        GLint linked;
+        glGetProgramiv(shaderProgram_, GL_LINK_STATUS, &linked);
+
+        auto pending = std::move(pending_);
+        std::string error;
+        if (linked == 0) {
+            error = ShaderError(pending->vertex_shader, GL_VERTEX_SHADER);
+            if (error.empty()) {
+                error =
+                    ShaderError(pending->fragment_shader, GL_FRAGMENT_SHADER);
+            }
+            if (error.empty()) {
+                error = ProgramError(shaderProgram_);
+            }
+        }
+        for (auto shader : {pending->vertex_shader, pending->fragment_shader}) {
+            if (shader != 0) {
+                glDetachShader(shaderProgram_, shader);
+                glDeleteShader(shader);
+            }
+        }
+        if (!error.empty()) {
+            glDeleteProgram(std::exchange(shaderProgram_, 0));
+            throw std::runtime_error(error);
+        }
+
+        if (pending->cache != nullptr && !pending->from_binary) {
+            pending->cache->store(pending->key, shaderProgram_);
+        }
+        bind_uniform_block("FrameUniforms", uniform_block::frame);
+        bind_uniform_block("DrawUniforms", uniform_block::draw);
+        bind_samplers();
+        cache_locations();
+    }
+
+    // Reads every active uniform and attribute once, so lookups afterwards
+    // only read the caches and threads sharing the program need no lock.
+    auto cache_locations() -> void {
+        auto read_active = [&](GLenum count_name, GLenum length_name,
+                               auto get_active, auto get_location,
+                               LocationCache& cache) {
+            GLint count      = 0;
+            GLint max_length = 0;
+            glGetProgramiv(shaderProgram_, count_name, &count);
+            glGetProgramiv(shaderProgram_, length_name, &max_length);
+            std::string name;
+            for (GLint i = 0; i < count; i++) {
+                name.assign(static_cast<size_t>(max_length), '\0');
+                GLsizei length = 0;
+                GLint size     = 0;
+                GLenum type    = 0;
+                get_active(shaderProgram_, static_cast<GLuint>(i), max_length,
+                           &length, &size, &type, name.data());
+                name.resize(static_cast<size_t>(length));
+                cache.emplace(name,
+                              get_location(shaderProgram_, name.c_str()));
+                // Arrays are listed by their first element; the rest, and
+                // the bare name, locate on their own.
+                if (name.ends_with("[0]")) {
+                    auto base = name.substr(0, name.size() - 3);
+                    cache.emplace(base, cache[name]);
+                    for (GLint element = 1; element < size; element++) {
+                        auto key = fmt::format("{}[{}]", base, element);
+                        cache.emplace(key,
+                                      get_location(shaderProgram_, key.c_str()));
+                    }
+                }
+            }
+        };
+        read_active(GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH,
+                    glGetActiveUniform, glGetUniformLocation,
+                    m_UniformLocationCache);
+        read_active(GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+                    glGetActiveAttrib, glGetAttribLocation,
+                    m_AttributeLocationCache);
+
+        m_FixedLocationCache =
+            std::make_unique<std::atomic<GLint>[]>(fixed_slots);  // NOLINT
+        for (size_t i = 0; i < fixed_slots; i++) {
+            m_FixedLocationCache[i].store(unresolved_location,
+                                          std::memory_order_relaxed);
+        }
+    }
+
+    // Inactive and unknown names are -1, as glGetUniformLocation has them.
+    GLint get_uniform_location(std::string_view name) const {
+        auto it = m_UniformLocationCache.find(name);
+        return it != m_UniformLocationCache.end() ? it->second : -1;
+    }
+
+    auto bind_samplers() const -> void {
+        use();
+        for (auto const& [name, unit] : sampler_units) {
+            GLint location = glGetUniformLocation(shaderProgram_, name);
+            if (location >= 0) {
+                glUniform1i(location, unit);
+            }
+        }
+    }
+
+private:
+    using LocationCache = std::unordered_map<std::string,
+                                             GLint,
+                                             detail::StringHash,
+                                             std::equal_to<>>;
+
+    GLuint shaderProgram_{};
+    LocationCache m_UniformLocationCache;
+    LocationCache m_AttributeLocationCache;
+    std::unique_ptr<std::atomic<GLint>[]> m_FixedLocationCache;  // NOLINT
+    std::unique_ptr<PendingLink> pending_;
+};
+
+// The program to draw with, swappable mid-session without a hitch: hand
+// replace() a deferred program and current() keeps returning the previous
+// one until the replacement is ready.
+struct ProgramSlot {
+    explicit ProgramSlot(ShaderProgram program)
+        : current_(std::move(program)) {
+    }
+
+    // Supersedes a replacement still being built.
+    auto replace(ShaderProgram program) -> void {
+        next_.emplace(std::move(program));
+    }
+
+    // Throws if the replacement failed to build, which drops it and leaves
+    // the previous program in place.
+    auto current() -> ShaderProgram& {
+        if (next_) {
+            bool ready = false;
+            try {
+                ready = next_->is_ready();
+            } catch (...) {
+                next_.reset();
+                throw;
+            }
+            if (ready) {
+                current_ = std::move(*next_);
+                next_.reset();
+            }
+        }
+        return current_;
+    }
+
+    auto is_pending() const noexcept -> bool {
+        return next_.has_value();
+    }
+
+private:
+    ShaderProgram current_;
+    std::optional<ShaderProgram> next_;
+};
+
+// Blocks until `fence` has signalled, then deletes it. A null fence is
+// treated as already signalled.
+inline auto wait_fence(GLsync& fence) -> void {
+    if (fence == nullptr) {
+        return;
+    }
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;) {
+        GLenum result = glClientWaitSync(fence, flags, 1'000'000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            break;
+        }
+        if (result == GL_WAIT_FAILED) {
+            throw std::runtime_error("Waiting on fence failed");
+        }
+        flags = 0;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+// One std140 struct in a UBO, e.g. FrameUniforms updated and bound once per
+// frame for every program.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct UniformBuffer {
+    explicit UniformBuffer(GLuint binding) : binding_(binding) {
+        glGenBuffers(1, &ubo_);
+        gl_state().bind_buffer(GL_UNIFORM_BUFFER, ubo_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    ~UniformBuffer() {
+        gl_state().forget_buffer(ubo_);
+        glDeleteBuffers(1, &ubo_);
+    }
+
+    UniformBuffer(UniformBuffer const&)            = delete;
+    UniformBuffer& operator=(UniformBuffer const&) = delete;
+
+    UniformBuffer(UniformBuffer&& other) noexcept
+        : ubo_(std::exchange(other.ubo_, 0)), binding_(other.binding_) {
+    }
+
+    UniformBuffer& operator=(UniformBuffer&& other) noexcept {
+        std::ranges::swap(other.ubo_, ubo_);
+        std::ranges::swap(other.binding_, binding_);
+        return *this;
+    }
+
+    auto set_data(T const& value) const -> void {
+        gl_state().bind_buffer(GL_UNIFORM_BUFFER, ubo_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &value);
+        detail::count_upload(sizeof(T));
+        detail::count_uniform_updates();
+    }
+
+    auto bind() const -> void {
+        gl_state().bind_buffer_base(GL_UNIFORM_BUFFER, binding_, ubo_);
+    }
+
+private:
+    GLuint ubo_{};
+    GLuint binding_;
+};
+
+// Streams a frame's worth of per-draw std140 structs into one UBO split into
+// `depth` fenced segments. A frame calls upload() once with every draw's
+// values, then bind(i) before draw i, then fence() after the last draw.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct UniformRing {
+    UniformRing(GLuint binding, size_t capacity, size_t depth = 3)
+        : binding_(binding)
+        , capacity_(capacity)
+        , fences_(depth == 0 ? 1 : depth)
+        , current_(fences_.size() - 1) {
+        GLint alignment = 1;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        auto align = static_cast<size_t>(std::max(alignment, 1));
+        stride_    = (sizeof(T) + align - 1) / align * align;
+
+        glGenBuffers(1, &ubo_);
+        gl_state().bind_buffer(GL_UNIFORM_BUFFER, ubo_);
+        glBufferData(GL_UNIFORM_BUFFER,
+                     static_cast<GLsizeiptr>(segment_size() * fences_.size()),
+                     nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    ~UniformRing() {
+        for (auto fence : fences_) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+            }
+        }
+        gl_state().forget_buffer(ubo_);
+        glDeleteBuffers(1, &ubo_);
+    }
+
+    UniformRing(UniformRing const&)            = delete;
+    UniformRing& operator=(UniformRing const&) = delete;
+
+    UniformRing(UniformRing&& other) noexcept
+        : ubo_(std::exchange(other.ubo_, 0))
+        , binding_(other.binding_)
+        , capacity_(other.capacity_)
+        , stride_(other.stride_)
+        , fences_(std::move(other.fences_))
+        , current_(other.current_) {
+    }
+
+    UniformRing& operator=(UniformRing&& other) noexcept {
+        std::ranges::swap(other.ubo_, ubo_);
+        std::ranges::swap(other.binding_, binding_);
+        std::ranges::swap(other.capacity_, capacity_);
+        std::ranges::swap(other.stride_, stride_);
+        std::ranges::swap(other.fences_, fences_);
+        std::ranges::swap(other.current_, current_);
+        return *this;
+    }
+
+    auto upload(std::span<T const> values) -> void {
+        if (values.size() > capacity_) {
+            throw std::runtime_error(
+                fmt::format("UniformRing holds {} values per frame, got {}",
+                            capacity_, values.size()));
+        }
+        current_ = (current_ + 1) % fences_.size();
+        wait_fence(fences_[current_]);
+        if (values.empty()) {
+            return;
+        }
+
+        gl_state().bind_buffer(GL_UNIFORM_BUFFER, ubo_);
+        auto* ptr = static_cast<std::byte*>(glMapBufferRange(
+            GL_UNIFORM_BUFFER,
+            static_cast<GLintptr>(current_ * segment_size()),
+            static_cast<GLsizeiptr>(values.size() * stride_),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                GL_MAP_UNSYNCHRONIZED_BIT));
+        if (ptr == nullptr) {
+            throw std::runtime_error("Failed to map uniform buffer");
+        }
+        for (auto const& value : values) {
+            std::memcpy(ptr, &value, sizeof(T));
+            ptr += stride_;
+        }
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        detail::count_upload(values.size() * stride_);
+        detail::count_uniform_updates(values.size());
+    }
+
+    auto bind(size_t index) const -> void {
+        gl_state().bind_buffer_range(
+            GL_UNIFORM_BUFFER, binding_, ubo_,
+            static_cast<GLintptr>((current_ * segment_size()) +
+                                  (index * stride_)),
+            sizeof(T));
+    }
+
+    // Once per upload(); fencing again replaces the earlier fence.
+    auto fence() -> void {
+        if (fences_[current_] != nullptr) {
+            glDeleteSync(fences_[current_]);
+        }
+        fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     }
 
 private:
-    GLuint shaderProgram_;
-    mutable std::unordered_map<std::string, GLint> m_UniformLocationCache;
-    mutable std::unordered_map<std::string, GLint> m_AttributeLocationCache;
+    auto segment_size() const -> size_t {
+        return stride_ * capacity_;
+    }
+
+    GLuint ubo_{};
+    GLuint binding_;
+    size_t capacity_;
+    size_t stride_{};
+    std::vector<GLsync> fences_;
+    size_t current_;
 };
 
 struct VertexBuffer {  // TODO: Enable Shared from this
@@ -155,6 +943,7 @@ struct VertexBuffer {  // TODO: Enable Shared from this
     }
 
     ~VertexBuffer() {
+        gl_state().forget_buffer(vbo_);
         glDeleteBuffers(1, &vbo_);
     }
 
@@ -171,16 +960,23 @@ struct VertexBuffer {  // TODO: Enable Shared from this
     }
 
     auto bind() const -> void {
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        gl_state().bind_buffer(GL_ARRAY_BUFFER, vbo_);
     }
     auto unbind() const -> void {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        gl_state().bind_buffer(GL_ARRAY_BUFFER, 0);
     }
 
-    auto set_data(std::span<std::byte const> data) const -> void {
+    // Reallocates; use DynamicBuffer or BufferRing for data that changes.
+    auto set_data(std::span<std::byte const> data,
+                  GLenum usage = GL_STATIC_DRAW) const -> void {
         bind();
         glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size()),
-                     data.data(), GL_STATIC_DRAW);
+                     data.data(), usage);
+        detail::count_upload(data.size());
+    }
+
+    auto get_id() const noexcept -> GLuint {
+        return vbo_;
     }
 
 private:
@@ -193,6 +989,7 @@ struct IndexBuffer {  // TODO: Enable Shared from this
     }
 
     ~IndexBuffer() {
+        gl_state().forget_buffer(ibo_);
         glDeleteBuffers(1, &ibo_);
     }
 
@@ -209,212 +1006,1493 @@ struct IndexBuffer {  // TODO: Enable Shared from this
     }
 
     auto bind() const -> void {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+        gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
     }
     auto unbind() const -> void {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 
-    auto set_data(std::span<uint32_t const> data) -> void {
-        bind();
+    // Leaves no VAO bound; call bind() after binding one to record this in
+    // it.
+    auto set_data(std::span<uint32_t const> data,
+                  GLenum usage = GL_STATIC_DRAW) -> void {
+        gl_state().bind_upload_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
         count_ = data.size();
         glBufferData(GL_ELEMENT_ARRAY_BUFFER,
                      static_cast<GLsizeiptr>(data.size_bytes()), data.data(),
-                     GL_STATIC_DRAW);
+                     usage);
+        detail::count_upload(data.size_bytes());
     }
 
     auto get_count() const noexcept -> uint32_t {
         return count_;
     }
 
-private:
-    GLuint ibo_;
-    uint32_t count_;
-};
+private:
+    GLuint ibo_;
+    uint32_t count_;
+};
+
+// Buffer whose contents change often, e.g. subtitle or overlay geometry.
+// Storage only ever grows, by doubling, so steady-state updates are
+// glBufferSubData() into the existing allocation and never reallocate.
+// Writing to an element array buffer leaves no VAO bound.
+struct DynamicBuffer {
+    explicit DynamicBuffer(GLenum target,
+                           GLenum usage     = GL_DYNAMIC_DRAW,
+                           size_t capacity = 0)
+        : target_(target), usage_(usage) {
+        glGenBuffers(1, &buffer_);
+        if (capacity > 0) {
+            reserve(capacity);
+        }
+    }
+
+    ~DynamicBuffer() {
+        gl_state().forget_buffer(buffer_);
+        glDeleteBuffers(1, &buffer_);
+    }
+
+    DynamicBuffer(DynamicBuffer const&)            = delete;
+    DynamicBuffer& operator=(DynamicBuffer const&) = delete;
+
+    DynamicBuffer(DynamicBuffer&& other) noexcept
+        : buffer_(std::exchange(other.buffer_, 0))
+        , target_(other.target_)
+        , usage_(other.usage_)
+        , size_(other.size_)
+        , capacity_(other.capacity_) {
+    }
+
+    DynamicBuffer& operator=(DynamicBuffer&& other) noexcept {
+        std::ranges::swap(other.buffer_, buffer_);
+        std::ranges::swap(other.target_, target_);
+        std::ranges::swap(other.usage_, usage_);
+        std::ranges::swap(other.size_, size_);
+        std::ranges::swap(other.capacity_, capacity_);
+        return *this;
+    }
+
+    auto bind() const -> void {
+        gl_state().bind_buffer(target_, buffer_);
+    }
+
+    // Replaces the contents. Shrinking keeps the allocation.
+    auto set_data(std::span<std::byte const> data) -> void {
+        if (data.size() > capacity_) {
+            reserve(std::max(data.size(), capacity_ * 2));
+        }
+        size_ = data.size();
+        write(0, data);
+    }
+
+    // Overwrites part of the current contents.
+    auto write(size_t offset, std::span<std::byte const> data) -> void {
+        if (offset + data.size() > size_) {
+            throw std::runtime_error(fmt::format(
+                "Write of {} bytes at {} is past the end of a {} byte buffer",
+                data.size(), offset, size_));
+        }
+        if (data.empty()) {
+            return;
+        }
+        gl_state().bind_upload_buffer(target_, buffer_);
+        glBufferSubData(target_, static_cast<GLintptr>(offset),
+                        static_cast<GLsizeiptr>(data.size()), data.data());
+        detail::count_upload(data.size());
+    }
+
+    // Reallocates when `capacity` is more than is held, dropping the contents.
+    auto reserve(size_t capacity) -> void {
+        if (capacity <= capacity_) {
+            return;
+        }
+        gl_state().bind_upload_buffer(target_, buffer_);
+        glBufferData(target_, static_cast<GLsizeiptr>(capacity), nullptr,
+                     usage_);
+        capacity_ = capacity;
+        size_     = 0;
+    }
+
+    auto get_id() const noexcept -> GLuint {
+        return buffer_;
+    }
+
+    auto get_size() const noexcept -> size_t {
+        return size_;
+    }
+
+    auto get_capacity() const noexcept -> size_t {
+        return capacity_;
+    }
+
+private:
+    GLuint buffer_{};
+    GLenum target_;
+    GLenum usage_;
+    size_t size_{};
+    size_t capacity_{};
+};
+
+// Ring of `depth` fenced segments for data rewritten every frame. A frame
+// calls begin_frame(), stream() for each block of data, draws from the
+// returned offsets and then end_frame(). Writes are unsynchronized maps of
+// a segment the GPU is known to be done with, so they never stall or
+// reallocate. GLES has no persistent mapping; this is the closest fit.
+struct BufferRing {
+    BufferRing(GLenum target, size_t segment_size, size_t depth = 3)
+        : target_(target), fences_(depth == 0 ? 1 : depth) {
+        glGenBuffers(1, &buffer_);
+        allocate(segment_size);
+    }
+
+    ~BufferRing() {
+        for (auto fence : fences_) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+            }
+        }
+        gl_state().forget_buffer(buffer_);
+        glDeleteBuffers(1, &buffer_);
+    }
+
+    BufferRing(BufferRing const&)            = delete;
+    BufferRing& operator=(BufferRing const&) = delete;
+
+    BufferRing(BufferRing&& other) noexcept
+        : buffer_(std::exchange(other.buffer_, 0))
+        , target_(other.target_)
+        , segment_size_(other.segment_size_)
+        , fences_(std::move(other.fences_))
+        , current_(other.current_)
+        , head_(other.head_) {
+    }
+
+    BufferRing& operator=(BufferRing&& other) noexcept {
+        std::ranges::swap(other.buffer_, buffer_);
+        std::ranges::swap(other.target_, target_);
+        std::ranges::swap(other.segment_size_, segment_size_);
+        std::ranges::swap(other.fences_, fences_);
+        std::ranges::swap(other.current_, current_);
+        std::ranges::swap(other.head_, head_);
+        return *this;
+    }
+
+    auto bind() const -> void {
+        gl_state().bind_buffer(target_, buffer_);
+    }
+
+    auto begin_frame() -> void {
+        current_ = (current_ + 1) % fences_.size();
+        head_    = 0;
+        wait_fence(fences_[current_]);
+    }
+
+    // Grows every segment to at least `segment_size`. The old storage is
+    // orphaned, so data streamed earlier this frame is gone; call it right
+    // after begin_frame().
+    auto reserve(size_t segment_size) -> void {
+        if (segment_size <= segment_size_) {
+            return;
+        }
+        allocate(std::max(segment_size, segment_size_ * 2));
+    }
+
+    // Copies `data` into the frame's segment, `alignment` aligned, and
+    // returns its offset in the buffer.
+    auto stream(std::span<std::byte const> data, size_t alignment = 4)
+        -> size_t {
+        auto offset = (head_ + alignment - 1) / alignment * alignment;
+        if (offset + data.size() > segment_size_) {
+            throw std::runtime_error(fmt::format(
+                "BufferRing segment of {} bytes cannot hold {} more",
+                segment_size_, data.size()));
+        }
+        head_ = offset + data.size();
+        offset += current_ * segment_size_;
+        if (data.empty()) {
+            return offset;
+        }
+
+        gl_state().bind_upload_buffer(target_, buffer_);
+        auto* ptr = glMapBufferRange(
+            target_, static_cast<GLintptr>(offset),
+            static_cast<GLsizeiptr>(data.size()),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                GL_MAP_UNSYNCHRONIZED_BIT);
+        if (ptr == nullptr) {
+            throw std::runtime_error("Failed to map buffer ring segment");
+        }
+        std::memcpy(ptr, data.data(), data.size());
+        glUnmapBuffer(target_);
+        detail::count_upload(data.size());
+        return offset;
+    }
+
+    // After the last draw sourcing this frame's segment; ending a frame
+    // again replaces the earlier fence.
+    auto end_frame() -> void {
+        if (fences_[current_] != nullptr) {
+            glDeleteSync(fences_[current_]);
+        }
+        fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    auto get_id() const noexcept -> GLuint {
+        return buffer_;
+    }
+
+    auto get_segment_size() const noexcept -> size_t {
+        return segment_size_;
+    }
+
+private:
+    auto allocate(size_t segment_size) -> void {
+        gl_state().bind_upload_buffer(target_, buffer_);
+        glBufferData(target_,
+                     static_cast<GLsizeiptr>(segment_size * fences_.size()),
+                     nullptr, GL_STREAM_DRAW);
+        segment_size_ = segment_size;
+        head_         = 0;
+        // The GPU keeps the orphaned storage alive; nothing left to wait on.
+        for (auto& fence : fences_) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+    }
+
+    GLuint buffer_{};
+    GLenum target_;
+    size_t segment_size_{};
+    std::vector<GLsync> fences_;
+    size_t current_{};
+    size_t head_{};
+};
+
+struct VertexAttribElement {
+    unsigned int type;
+    size_t count;
+    unsigned char normalized;
+    size_t offset;
+};
+
+// IEEE 754 binary16, as GL_HALF_FLOAT attributes store it.
+struct Half {
+    uint16_t bits;
+};
+
+// Rounds to nearest even; out of range values become infinity.
+constexpr auto to_half(float value) -> Half {
+    auto bits     = std::bit_cast<uint32_t>(value);
+    auto sign     = static_cast<uint16_t>((bits >> 16U) & 0x8000U);
+    auto exponent = static_cast<int>((bits >> 23U) & 0xFFU);
+    auto mantissa = bits & 0x7FFFFFU;
+
+    if (exponent == 0xFF) {  // Infinity or NaN; keep NaNs quiet.
+        return {static_cast<uint16_t>(sign | 0x7C00U |
+                                      (mantissa != 0 ? 0x200U : 0U))};
+    }
+    exponent -= 127 - 15;
+    if (exponent >= 0x1F) {
+        return {static_cast<uint16_t>(sign | 0x7C00U)};
+    }
+    if (exponent <= 0) {  // Subnormal half, or zero.
+        if (exponent < -10) {
+            return {sign};
+        }
+        mantissa |= 0x800000U;
+        auto shift    = static_cast<uint32_t>(14 - exponent);
+        auto half     = mantissa >> shift;
+        auto rest     = mantissa & ((1U << shift) - 1U);
+        auto halfway  = 1U << (shift - 1U);
+        if (rest > halfway || (rest == halfway && (half & 1U) != 0)) {
+            half++;
+        }
+        return {static_cast<uint16_t>(sign | half)};
+    }
+    auto half = (static_cast<uint32_t>(exponent) << 10U) | (mantissa >> 13U);
+    auto rest = mantissa & 0x1FFFU;
+    // A carry out of the mantissa correctly bumps the exponent.
+    if (rest > 0x1000U || (rest == 0x1000U && (half & 1U) != 0)) {
+        half++;
+    }
+    return {static_cast<uint16_t>(sign | half)};
+}
+
+// [-1, 1] and [0, 1] to the integers GL normalizes back to them.
+constexpr auto to_snorm16(float value) -> int16_t {
+    auto clamped = std::clamp(value, -1.0F, 1.0F) * 32767.0F;
+    return static_cast<int16_t>(clamped < 0.0F ? clamped - 0.5F
+                                               : clamped + 0.5F);
+}
+
+constexpr auto to_unorm16(float value) -> uint16_t {
+    return static_cast<uint16_t>(std::clamp(value, 0.0F, 1.0F) * 65535.0F +
+                                 0.5F);
+}
+
+namespace detail {
+template <typename T>
+struct attrib_type;
+
+template <>
+struct attrib_type<float> : std::integral_constant<GLenum, GL_FLOAT> {};
+template <>
+struct attrib_type<Half> : std::integral_constant<GLenum, GL_HALF_FLOAT> {};
+template <>
+struct attrib_type<int8_t> : std::integral_constant<GLenum, GL_BYTE> {};
+template <>
+struct attrib_type<uint8_t>
+    : std::integral_constant<GLenum, GL_UNSIGNED_BYTE> {};
+template <>
+struct attrib_type<int16_t> : std::integral_constant<GLenum, GL_SHORT> {};
+template <>
+struct attrib_type<uint16_t>
+    : std::integral_constant<GLenum, GL_UNSIGNED_SHORT> {};
+};  // namespace detail
+
+template <typename T>
+concept VertexAttribType = requires { detail::attrib_type<T>::value; };
+
+struct VertexBufferLayout {
+    // Integer components are normalized to [0, 1] (unsigned) or [-1, 1]
+    // (signed) by default; pass false to read them as plain floats.
+    template <VertexAttribType T>
+    auto push(size_t count,
+              size_t offset,
+              bool normalized = std::is_integral_v<T>) -> void {
+        elements_.push_back({detail::attrib_type<T>::value, count,
+                             static_cast<unsigned char>(
+                                 normalized ? GL_TRUE : GL_FALSE),
+                             offset});
+    }
+
+    auto get_elements() const -> std::span<VertexAttribElement const> {
+        return elements_;
+    }
+
+    auto get_stride() const -> size_t {
+        return stride_;
+    }
+
+    auto set_stride(size_t stride) -> void {
+        stride_ = stride;
+    }
+
+private:
+    std::vector<VertexAttribElement> elements_;
+    size_t stride_{};
+};
+
+struct VertexArray {
+    VertexArray(std::shared_ptr<VertexBuffer> vbo,
+                VertexBufferLayout const& layout)
+        : vbo_(std::move(vbo)) {
+        glGenVertexArrays(1, &vao_);
+        bind();
+        vbo_->bind();
+
+        auto const& elements = layout.get_elements();
+        size_t offset        = 0;
+
+        for (auto i = 0; i < elements.size(); i++) {
+            auto const& element = elements[i];
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(
+                i, static_cast<GLint>(element.count), element.type,
+                element.normalized, static_cast<GLsizei>(layout.get_stride()),
+                reinterpret_cast<void const*>(element.offset));  // NOLINT
+        }
+        unbind();
+    }
+
+    ~VertexArray() {
+        gl_state().forget_vertex_array(vao_);
+        glDeleteVertexArrays(1, &vao_);
+    }
+    VertexArray(VertexArray const&)            = delete;
+    VertexArray& operator=(VertexArray const&) = delete;
+
+    VertexArray(VertexArray&& other) noexcept
+        : vao_(std::exchange(other.vao_, 0)) {
+    }
+
+    VertexArray& operator=(VertexArray&& other) noexcept {
+        std::ranges::swap(other.vao_, vao_);
+        return *this;
+    }
+
+    auto bind() const -> void {
+        gl_state().bind_vertex_array(vao_);
+    }
+
+    auto unbind() const -> void {
+        gl_state().bind_vertex_array(0);
+    }
+
+    // Points per-instance attributes starting at `first_location` into
+    // `instances`, `base_offset` bytes in. Expects this VAO to be bound.
+    auto set_instance_attributes(GLuint instances,
+                                 VertexBufferLayout const& layout,
+                                 GLuint first_location,
+                                 size_t base_offset) const -> void {
+        gl_state().bind_buffer(GL_ARRAY_BUFFER, instances);
+
+        auto const& elements = layout.get_elements();
+        for (size_t i = 0; i < elements.size(); i++) {
+            auto const& element = elements[i];
+            auto location       = first_location + static_cast<GLuint>(i);
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(
+                location, static_cast<GLint>(element.count), element.type,
+                element.normalized, static_cast<GLsizei>(layout.get_stride()),
+                reinterpret_cast<void const*>(  // NOLINT
+                    base_offset + element.offset));
+            glVertexAttribDivisor(location, 1);
+        }
+    }
+
+    auto disable_attributes(GLuint first_location, size_t count) const
+        -> void {
+        for (size_t i = 0; i < count; i++) {
+            glDisableVertexAttribArray(first_location + static_cast<GLuint>(i));
+        }
+    }
+
+private:
+    std::shared_ptr<VertexBuffer> vbo_;
+    GLuint vao_;
+};
+
+// Fixed ring of GL_PIXEL_UNPACK_BUFFERs. Every slot is allocated once and
+// fenced after the transfer that reads from it, so mapping the next slot never
+// stalls on an upload that is still in flight.
+struct PixelUnpackRing {
+    static constexpr size_t default_depth = 3;
+
+    explicit PixelUnpackRing(size_t slot_size, size_t depth = default_depth)
+        : slots_(depth == 0 ? 1 : depth) {
+        for (auto& slot : slots_) {
+            glGenBuffers(1, &slot.pbo);
+            if (slot_size == 0) {
+                continue;  // allocated by the first map()
+            }
+            gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER,
+                         static_cast<GLsizeiptr>(slot_size), nullptr,
+                         GL_STREAM_DRAW);
+            slot.capacity = slot_size;
+        }
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    ~PixelUnpackRing() {
+        release();
+    }
+
+    PixelUnpackRing(PixelUnpackRing const&)            = delete;
+    PixelUnpackRing& operator=(PixelUnpackRing const&) = delete;
+
+    PixelUnpackRing(PixelUnpackRing&& other) noexcept
+        : slots_(std::exchange(other.slots_, {}))
+        , current_(std::exchange(other.current_, 0))
+        , mapped_(std::exchange(other.mapped_, false))
+        , maps_(std::exchange(other.maps_, 0)) {
+    }
+
+    PixelUnpackRing& operator=(PixelUnpackRing&& other) noexcept {
+        std::ranges::swap(other.slots_, slots_);
+        std::ranges::swap(other.current_, current_);
+        std::ranges::swap(other.mapped_, mapped_);
+        std::ranges::swap(other.maps_, maps_);
+        return *this;
+    }
+
+    // Binds the current slot to GL_PIXEL_UNPACK_BUFFER and maps `size` bytes
+    // of it for writing. Blocks only if the slot's previous upload, issued
+    // depth() uploads ago, has not finished yet.
+    auto map(size_t size) -> std::span<std::byte> {
+        if (mapped_) {
+            throw std::runtime_error("Pixel unpack buffer already mapped");
+        }
+        auto& slot = slots_[current_];
+        wait_fence(slot.fence);
+
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (size > slot.capacity) {
+            // Only hit when a caller's pitch outgrows the texture's packed
+            // size; the slot keeps the larger allocation from then on.
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size),
+                         nullptr, GL_STREAM_DRAW);
+            slot.capacity = size;
+        }
+
+        void* ptr = glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                GL_MAP_UNSYNCHRONIZED_BIT);
+        if (ptr == nullptr) {
+            throw std::runtime_error("Failed to map pixel unpack buffer");
+        }
+        mapped_ = true;
+        maps_++;
+        return {static_cast<std::byte*>(ptr), size};
+    }
+
+    // Counts map() calls, so a mapping can be told apart from later ones.
+    auto map_count() const noexcept -> uint64_t {
+        return maps_;
+    }
+
+    // Unmaps without uploading if mapping number `map` is still the one
+    // open; the slot is reused by the next map(). For abandoned uploads.
+    auto discard(uint64_t map) noexcept -> void {
+        if (!mapped_ || map != maps_) {
+            return;
+        }
+        mapped_ = false;
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, slots_[current_].pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // Unmaps the current slot, which stays bound so the caller can source a
+    // glTexSubImage* from it.
+    auto unmap() -> void {
+        if (!mapped_) {
+            throw std::runtime_error("Pixel unpack buffer is not mapped");
+        }
+        mapped_ = false;
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, slots_[current_].pbo);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+            throw std::runtime_error("Pixel unpack buffer contents corrupted");
+        }
+    }
+
+    // Fences the transfers issued from the current slot and advances the ring.
+    auto fence() -> void {
+        slots_[current_].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        current_               = (current_ + 1) % slots_.size();
+    }
+
+    auto depth() const noexcept -> size_t {
+        return slots_.size();
+    }
+
+private:
+    struct Slot {
+        GLuint pbo{};
+        size_t capacity{};
+        GLsync fence{};
+    };
+
+    auto release() -> void {
+        for (auto& slot : slots_) {
+            if (slot.fence != nullptr) {
+                glDeleteSync(slot.fence);
+            }
+            gl_state().forget_buffer(slot.pbo);
+            glDeleteBuffers(1, &slot.pbo);
+        }
+        slots_.clear();
+    }
+
+    std::vector<Slot> slots_;
+    size_t current_{};
+    bool mapped_{};
+    uint64_t maps_{};
+};
+
+// Area in pixels. In a window, with the top-left origin the ortho projection
+// uses; in a texture, counted from the first row uploaded.
+struct Rect {
+    int x;
+    int y;
+    int width;
+    int height;
+
+    auto empty() const noexcept -> bool {
+        return width <= 0 || height <= 0;
+    }
+
+    auto united(Rect const& other) const noexcept -> Rect {
+        if (empty()) {
+            return other;
+        }
+        if (other.empty()) {
+            return *this;
+        }
+        auto left   = std::min(x, other.x);
+        auto top    = std::min(y, other.y);
+        auto right  = std::max(x + width, other.x + other.width);
+        auto bottom = std::max(y + height, other.y + other.height);
+        return {left, top, right - left, bottom - top};
+    }
+
+    auto clipped(int max_width, int max_height) const noexcept -> Rect {
+        auto left   = std::max(x, 0);
+        auto top    = std::max(y, 0);
+        auto right  = std::min(x + width, max_width);
+        auto bottom = std::min(y + height, max_height);
+        return {left, top, std::max(right - left, 0),
+                std::max(bottom - top, 0)};
+    }
+};
+
+// Mapped, write-only view of a texture's staging buffer handed out by
+// begin_upload(). Fill it front to back (decoders can write straight into it)
+// and pass it back to commit(); reading from it is not supported. A frame
+// dropped without a commit unmaps its buffer, so the next begin_upload()
+// works; it must not outlive the texture it came from.
+struct UploadFrame {
+    // Maps `size` bytes of the next buffer of `ring`.
+    UploadFrame(PixelUnpackRing& ring, size_t size, int pitch)
+        : data_(ring.map(size))
+        , pitch_(pitch)
+        , ring_(&ring)
+        , map_(ring.map_count()) {
+    }
+
+    // Over memory the caller owns; nothing to unmap.
+    UploadFrame(std::span<std::byte> data, int pitch)
+        : data_(data), pitch_(pitch) {
+    }
+
+    ~UploadFrame() {
+        if (ring_ != nullptr) {
+            ring_->discard(map_);
+        }
+    }
+
+    UploadFrame(UploadFrame const&)            = delete;
+    UploadFrame& operator=(UploadFrame const&) = delete;
+
+    UploadFrame(UploadFrame&& other) noexcept
+        : data_(std::exchange(other.data_, {}))
+        , pitch_(other.pitch_)
+        , ring_(std::exchange(other.ring_, nullptr))
+        , map_(other.map_) {
+    }
+
+    UploadFrame& operator=(UploadFrame&& other) noexcept {
+        std::ranges::swap(other.data_, data_);
+        std::ranges::swap(other.pitch_, pitch_);
+        std::ranges::swap(other.ring_, ring_);
+        std::ranges::swap(other.map_, map_);
+        return *this;
+    }
+
+    auto data() const noexcept -> std::byte* {
+        return data_.data();
+    }
+
+    auto span() const noexcept -> std::span<std::byte> {
+        return data_;
+    }
+
+    auto size() const noexcept -> size_t {
+        return data_.size();
+    }
+
+    auto pitch() const noexcept -> int {
+        return pitch_;
+    }
+
+private:
+    std::span<std::byte> data_;
+    int pitch_;
+    PixelUnpackRing* ring_{};
+    uint64_t map_{};
+};
+
+constexpr auto bytes_per_pixel_of(int format) -> int {
+    switch (format) {
+        case GL_RGBA:
+            return 4;
+        case GL_RGB:
+            return 3;
+        case GL_RG:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+constexpr auto internal_format_of(int format) -> GLint {
+    switch (format) {
+        case GL_RED:
+            return GL_R8;
+        case GL_RG:
+            return GL_RG8;
+        default:
+            return format;
+    }
+}
+
+namespace detail {
+struct UnpackLayout {
+    GLint alignment;
+    GLint row_length;
+};
+
+// Unpack state for rows of `width` pixels laid `pitch` bytes apart, with the
+// widest GL_UNPACK_ALIGNMENT the pitch allows; at 1, drivers tend to copy
+// row by row. Pitches that are not a whole number of pixels are taken as
+// rows padded up to the alignment.
+inline auto unpack_layout_of(int pitch, int width, int bytes_per_pixel)
+    -> UnpackLayout {
+    auto row = width * bytes_per_pixel;
+    if (pitch >= row) {
+        for (GLint alignment : {8, 4, 2, 1}) {
+            if (pitch % alignment != 0) {
+                continue;
+            }
+            if (pitch % bytes_per_pixel == 0) {
+                return {alignment, pitch == row ? 0 : pitch / bytes_per_pixel};
+            }
+            if ((row + alignment - 1) / alignment * alignment == pitch) {
+                return {alignment, 0};
+            }
+        }
+    }
+    throw std::runtime_error(fmt::format(
+        "Unsupported pitch of {} bytes for {} pixels of {} bytes", pitch,
+        width, bytes_per_pixel));
+}
+
+inline auto set_unpack_layout(UnpackLayout const& layout) -> void {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, layout.alignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, layout.row_length);
+}
+
+inline auto set_unpack_layout(int pitch, int width, int bytes_per_pixel)
+    -> void {
+    set_unpack_layout(unpack_layout_of(pitch, width, bytes_per_pixel));
+}
+
+inline auto reset_unpack_layout() -> void {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// The last row only needs its pixels, not the padding after them.
+inline auto check_upload_size(size_t size, int pitch, int row, int rows)
+    -> void {
+    auto expected = rows > 0 ? static_cast<size_t>(pitch) *
+                                       static_cast<size_t>(rows - 1) +
+                                   static_cast<size_t>(row)
+                             : 0;
+    if (size < expected) {
+        throw std::runtime_error(
+            fmt::format("Upload too small: {} bytes, expected {} for {} rows "
+                        "{} bytes apart",
+                        size, expected, rows, pitch));
+    }
+}
+};  // namespace detail
+
+template <int format =
+              GL_RGBA>  // TODO: Unsized formats only for now, plus R8/RG8
+    requires(format == GL_RGBA || format == GL_RGB || format == GL_RED ||
+             format == GL_RG)
+struct Texture {
+    // A `staging_depth` of 0 puts off allocating staging memory until the
+    // first upload, for textures that are mostly rendered to.
+    Texture(GLsizei width,
+            GLsizei height,
+            size_t staging_depth = PixelUnpackRing::default_depth)
+        : width_(width)
+        , height_(height)  // TODO: Stronger types
+        , buffer_size_(static_cast<size_t>(width) *
+                       static_cast<size_t>(height) * bytes_per_pixel)
+        , staging_(staging_depth == 0 ? 0 : buffer_size_, staging_depth) {
+        glGenTextures(1, &textureId_);
+        bind();
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        if constexpr (format == GL_RGBA || format == GL_RGB) {
+            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+                         GL_UNSIGNED_BYTE, nullptr);
+        } else if constexpr (format == GL_RED) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, format,
+                         GL_UNSIGNED_BYTE, nullptr);
+        } else if constexpr (format == GL_RG) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, format,
+                         GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+
+    auto bind() -> void {
+        gl_state().bind_texture(GL_TEXTURE_2D, textureId_);
+    }
+    auto unbind() -> void {
+        gl_state().bind_texture(GL_TEXTURE_2D, 0);
+    }
+
+    // Maps the next staging buffer so the caller can write a frame into it
+    // directly; `pitch` is in bytes and defaults to tightly packed rows.
+    // Commit it, or drop it, before the next begin_upload().
+    [[nodiscard]] auto begin_upload(int pitch = 0) -> UploadFrame {
+        return begin_upload({0, 0, width_, height_}, pitch);
+    }
+
+    // As begin_upload(), for just the rows of `rect`; commit the frame with
+    // the same rect.
+    [[nodiscard]] auto begin_upload(Rect const& rect, int pitch = 0)
+        -> UploadFrame {
+        check_region(rect);
+        if (pitch <= 0) {
+            pitch = rect.width * bytes_per_pixel;
+        }
+        auto size =
+            static_cast<size_t>(pitch) * static_cast<size_t>(rect.height);
+        return {staging_, size, pitch};
+    }
+
+    auto commit(UploadFrame const& frame) -> void {
+        commit(frame, {0, 0, width_, height_});
+    }
+
+    // As commit(), for a frame holding only the rows of `rect`. On a rect or
+    // pitch the frame does not fit, throws with the frame still mapped, so
+    // it can be committed again with the right one.
+    auto commit(UploadFrame const& frame, Rect const& rect) -> void {
+        check_region(rect);
+        auto layout = detail::unpack_layout_of(frame.pitch(), rect.width,
+                                               bytes_per_pixel);
+        detail::check_upload_size(frame.size(), frame.pitch(),
+                                  rect.width * bytes_per_pixel, rect.height);
+        staging_.unmap();
+        bind();
+
+        detail::set_unpack_layout(layout);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width,
+                        rect.height, format, GL_UNSIGNED_BYTE,
+                        static_cast<void*>(nullptr));
+        staging_.fence();
+        revision_++;
+        detail::count_upload(frame.size());
+
+        detail::reset_unpack_layout();
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    auto copy_data(std::span<std::byte const> data, int pitch) {
+        copy_data_region({0, 0, width_, height_}, data, pitch);
+    }
+
+    // Replaces `rect` only, from `data` holding just its rows, `pitch` bytes
+    // apart (tightly packed by default). Costs a copy of the region, not of
+    // the whole texture.
+    auto copy_data_region(Rect const& rect,
+                          std::span<std::byte const> data,
+                          int pitch = 0) -> void {
+        CpuZone zone{"copy_data"};
+        check_region(rect);
+        if (pitch <= 0) {
+            pitch = rect.width * bytes_per_pixel;
+        }
+        detail::check_upload_size(data.size(), pitch,
+                                  rect.width * bytes_per_pixel, rect.height);
+        UploadFrame frame{staging_, data.size(), pitch};
+        std::memcpy(frame.data(), data.data(), data.size());
+        commit(frame, rect);
+    }
+
+    auto get_id() const noexcept -> GLuint {
+        return textureId_;
+    }
+
+    // Bumped by every commit, so damage tracking can tell new contents apart.
+    auto get_revision() const noexcept -> uint64_t {
+        return revision_;
+    }
+
+    // For contents written by GL itself, e.g. as a RenderTarget.
+    auto mark_updated() noexcept -> void {
+        revision_++;
+    }
+
+    auto get_width() const noexcept -> GLsizei {
+        return width_;
+    }
+
+    auto get_height() const noexcept -> GLsizei {
+        return height_;
+    }
+
+    ~Texture() {
+        gl_state().forget_texture(textureId_);
+        glDeleteTextures(1, &textureId_);
+    }
+    Texture(Texture const&)            = delete;
+    Texture& operator=(Texture const&) = delete;
+
+    Texture(Texture&& other) noexcept
+        : width_(other.width_)
+        , height_(other.height_)
+        , textureId_(std::exchange(other.textureId_, 0))
+        , buffer_size_(other.buffer_size_)
+        , staging_(std::move(other.staging_))
+        , revision_(other.revision_) {
+    }
+
+    Texture& operator=(Texture&& other) noexcept {
+        std::ranges::swap(other.width_, width_);
+        std::ranges::swap(other.height_, height_);
+        std::ranges::swap(other.textureId_, textureId_);
+        std::ranges::swap(other.buffer_size_, buffer_size_);
+        std::ranges::swap(other.staging_, staging_);
+        std::ranges::swap(other.revision_, revision_);
+        return *this;
+    }
+
+private:
+    static constexpr int bytes_per_pixel = bytes_per_pixel_of(format);
+
+    auto check_region(Rect const& rect) const -> void {
+        if (rect.empty() || rect.x < 0 || rect.y < 0 ||
+            rect.x + rect.width > width_ || rect.y + rect.height > height_) {
+            throw std::runtime_error(fmt::format(
+                "Region {}x{}+{}+{} outside of {}x{} texture", rect.width,
+                rect.height, rect.x, rect.y, width_, height_));
+        }
+    }
+
+    GLsizei width_;
+    GLsizei height_;
+    GLuint textureId_{};
+    size_t buffer_size_;
+    PixelUnpackRing staging_;
+    uint64_t revision_{};
+};
+
+// Offscreen framebuffer whose colour buffer is a Texture<GL_RGBA>, so what is
+// drawn into it can be sampled by any Renderable, e.g. a layer composited
+// once and reused for many frames, or a video frame converted once into a
+// thumbnail. With `samples`, drawing goes to a multisampled renderbuffer that
+// end() resolves into the texture.
+//
+// Draw between begin() and end() with get_projection(): it flips y so that
+// the result has the row order of uploaded textures and shows upright.
+struct RenderTarget {
+    RenderTarget(GLsizei width, GLsizei height, GLsizei samples = 0)
+        : texture_(std::make_shared<Texture<GL_RGBA>>(width, height, 0)) {
+        glGenFramebuffers(1, &framebuffer_);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, texture_->get_id(), 0);
+        check_complete("colour");
+
+        GLint max_samples = 0;
+        glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+        samples = std::min(samples, static_cast<GLsizei>(max_samples));
+        if (samples > 1) {
+            glGenRenderbuffers(1, &renderbuffer_);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer_);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples,
+                                             GL_RGBA8, width, height);
+            glGenFramebuffers(1, &multisample_framebuffer_);
+            glBindFramebuffer(GL_FRAMEBUFFER, multisample_framebuffer_);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                      GL_RENDERBUFFER, renderbuffer_);
+            check_complete("multisample");
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~RenderTarget() {
+        release();
+    }
+
+    RenderTarget(RenderTarget const&)            = delete;
+    RenderTarget& operator=(RenderTarget const&) = delete;
+
+    RenderTarget(RenderTarget&& other) noexcept
+        : texture_(std::move(other.texture_))
+        , framebuffer_(std::exchange(other.framebuffer_, 0))
+        , multisample_framebuffer_(
+              std::exchange(other.multisample_framebuffer_, 0))
+        , renderbuffer_(std::exchange(other.renderbuffer_, 0)) {
+    }
+
+    RenderTarget& operator=(RenderTarget&& other) noexcept {
+        std::ranges::swap(other.texture_, texture_);
+        std::ranges::swap(other.framebuffer_, framebuffer_);
+        std::ranges::swap(other.multisample_framebuffer_,
+                          multisample_framebuffer_);
+        std::ranges::swap(other.renderbuffer_, renderbuffer_);
+        return *this;
+    }
+
+    // Redirects drawing here and sets the viewport to the target. The
+    // scissor test, if enabled, still applies.
+    auto begin() const -> void {
+        glBindFramebuffer(GL_FRAMEBUFFER, multisample_framebuffer_ != 0
+                                              ? multisample_framebuffer_
+                                              : framebuffer_);
+        glViewport(0, 0, get_width(), get_height());
+    }
+
+    // Resolves multisampling and goes back to the default framebuffer; the
+    // caller restores its viewport.
+    auto end() -> void {
+        if (multisample_framebuffer_ != 0) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, multisample_framebuffer_);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer_);
+            glBlitFramebuffer(0, 0, get_width(), get_height(), 0, 0,
+                              get_width(), get_height(), GL_COLOR_BUFFER_BIT,
+                              GL_NEAREST);
+            // The samples are not needed past the resolve; tilers can then
+            // skip writing them back to memory.
+            GLenum attachment = GL_COLOR_ATTACHMENT0;
+            glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, 1, &attachment);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        texture_->mark_updated();
+    }
+
+    auto get_projection() const -> glm::mat4 {
+        return glm::ortho(0.0F, static_cast<float>(get_width()), 0.0F,
+                          static_cast<float>(get_height()));
+    }
+
+    auto get_texture() const noexcept
+        -> std::shared_ptr<Texture<GL_RGBA>> const& {
+        return texture_;
+    }
+
+    auto get_width() const noexcept -> GLsizei {
+        return texture_->get_width();
+    }
+
+    auto get_height() const noexcept -> GLsizei {
+        return texture_->get_height();
+    }
+
+private:
+    auto check_complete(char const* what) -> void {
+        auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            release();
+            throw std::runtime_error(fmt::format(
+                "Incomplete {} framebuffer: {:#x}", what, status));
+        }
+    }
+
+    auto release() -> void {
+        glDeleteFramebuffers(1, &framebuffer_);
+        glDeleteFramebuffers(1, &multisample_framebuffer_);
+        glDeleteRenderbuffers(1, &renderbuffer_);
+        framebuffer_             = 0;
+        multisample_framebuffer_ = 0;
+        renderbuffer_            = 0;
+    }
+
+    std::shared_ptr<Texture<GL_RGBA>> texture_;
+    GLuint framebuffer_{};
+    GLuint multisample_framebuffer_{};
+    GLuint renderbuffer_{};
+};
+
+// Stack of same-sized layers in one GL_TEXTURE_2D_ARRAY. Each layer is a slot
+// that a Renderable can sample by index, so tiles that share a resolution are
+// drawn with a single bind.
+template <int format = GL_RGBA>
+    requires(format == GL_RGBA || format == GL_RGB || format == GL_RED ||
+             format == GL_RG)
+struct TextureArray {
+    TextureArray(GLsizei width,
+                 GLsizei height,
+                 GLsizei layers,
+                 size_t staging_depth = PixelUnpackRing::default_depth)
+        : width_(width)
+        , height_(height)
+        , layers_(layers)
+        , staging_(static_cast<size_t>(width) * static_cast<size_t>(height) *
+                       bytes_per_pixel,
+                   staging_depth) {
+        glGenTextures(1, &textureId_);
+        bind();
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internal_format_of(format), width,
+                     height, layers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+
+        free_layers_.reserve(static_cast<size_t>(layers));
+        for (GLsizei layer = layers; layer > 0; layer--) {
+            free_layers_.push_back(layer - 1);
+        }
+    }
+
+    ~TextureArray() {
+        gl_state().forget_texture(textureId_);
+        glDeleteTextures(1, &textureId_);
+    }
+    TextureArray(TextureArray const&)            = delete;
+    TextureArray& operator=(TextureArray const&) = delete;
+
+    TextureArray(TextureArray&& other) noexcept
+        : width_(other.width_)
+        , height_(other.height_)
+        , layers_(other.layers_)
+        , textureId_(std::exchange(other.textureId_, 0))
+        , staging_(std::move(other.staging_))
+        , free_layers_(std::move(other.free_layers_))
+        , revision_(other.revision_) {
+    }
+
+    TextureArray& operator=(TextureArray&& other) noexcept {
+        std::ranges::swap(other.width_, width_);
+        std::ranges::swap(other.height_, height_);
+        std::ranges::swap(other.layers_, layers_);
+        std::ranges::swap(other.textureId_, textureId_);
+        std::ranges::swap(other.staging_, staging_);
+        std::ranges::swap(other.free_layers_, free_layers_);
+        std::ranges::swap(other.revision_, revision_);
+        return *this;
+    }
+
+    auto bind() const -> void {
+        gl_state().bind_texture(GL_TEXTURE_2D_ARRAY, textureId_);
+    }
+    auto unbind() const -> void {
+        gl_state().bind_texture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    auto acquire_layer() -> GLsizei {
+        if (free_layers_.empty()) {
+            throw std::runtime_error("No free layers left in texture array");
+        }
+        auto layer = free_layers_.back();
+        free_layers_.pop_back();
+        return layer;
+    }
+
+    auto release_layer(GLsizei layer) -> void {
+        check_layer(layer);
+        if (std::ranges::find(free_layers_, layer) != free_layers_.end()) {
+            throw std::runtime_error(fmt::format(
+                "Layer {} of texture array released twice", layer));
+        }
+        free_layers_.push_back(layer);
+    }
+
+    [[nodiscard]] auto begin_upload(int pitch = 0) -> UploadFrame {
+        if (pitch <= 0) {
+            pitch = width_ * bytes_per_pixel;
+        }
+        auto size = static_cast<size_t>(pitch) * static_cast<size_t>(height_);
+        return {staging_, size, pitch};
+    }
+
+    // Throws with the frame still mapped on a bad layer or a frame too small.
+    auto commit(UploadFrame const& frame, GLsizei layer) -> void {
+        check_layer(layer);
+        auto layout =
+            detail::unpack_layout_of(frame.pitch(), width_, bytes_per_pixel);
+        detail::check_upload_size(frame.size(), frame.pitch(),
+                                  width_ * bytes_per_pixel, height_);
+        staging_.unmap();
+        bind();
 
-struct VertexAttribElement {
-    unsigned int type;
-    size_t count;
-    unsigned char normalized;
-    size_t offset;
-};
+        detail::set_unpack_layout(layout);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width_, height_, 1,
+                        format, GL_UNSIGNED_BYTE, static_cast<void*>(nullptr));
+        staging_.fence();
+        revision_++;
+        detail::count_upload(frame.size());
 
-struct VertexBufferLayout {
-    template <typename T>
-    auto push(size_t count, size_t offset) {
-        /*
-        static_assert(false, "Unknown type pushed to VertexBufferLayout");
-        */
-        throw std::runtime_error("Unknown type pushed to VertexBufferLayout");
+        detail::reset_unpack_layout();
+
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
     }
 
-    template <>
-    auto push<float>(size_t count, size_t offset) {
-        elements_.push_back({GL_FLOAT, count, GL_FALSE, offset});
+    auto copy_data(GLsizei layer, std::span<std::byte const> data, int pitch)
+        -> void {
+        CpuZone zone{"copy_data"};
+        check_layer(layer);
+        if (pitch <= 0) {
+            pitch = width_ * bytes_per_pixel;
+        }
+        detail::check_upload_size(data.size(), pitch, width_ * bytes_per_pixel,
+                                  height_);
+        UploadFrame frame{staging_, data.size(), pitch};
+        std::memcpy(frame.data(), data.data(), data.size());
+        commit(frame, layer);
     }
 
-    auto get_elements() const -> std::span<VertexAttribElement const> {
-        return elements_;
+    auto get_id() const noexcept -> GLuint {
+        return textureId_;
     }
 
-    auto get_stride() const -> size_t {
-        return stride_;
+    auto get_layers() const noexcept -> GLsizei {
+        return layers_;
     }
 
-    auto set_stride(size_t stride) -> void {
-        stride_ = stride;
+    // Bumped by every commit, so damage tracking can tell new contents apart.
+    auto get_revision() const noexcept -> uint64_t {
+        return revision_;
     }
 
 private:
-    std::vector<VertexAttribElement> elements_;
-    size_t stride_{};
-};
+    static constexpr int bytes_per_pixel = bytes_per_pixel_of(format);
 
-struct VertexArray {
-    VertexArray(std::shared_ptr<VertexBuffer> vbo,
-                VertexBufferLayout const& layout)
-        : vbo_(std::move(vbo)) {
-        glGenVertexArrays(1, &vao_);
-        bind();
-        vbo_->bind();
+    auto check_layer(GLsizei layer) const -> void {
+        if (layer < 0 || layer >= layers_) {
+            throw std::runtime_error(fmt::format(
+                "Layer {} outside of {}-layer texture array", layer, layers_));
+        }
+    }
 
-        auto const& elements = layout.get_elements();
-        size_t offset        = 0;
+    GLsizei width_;
+    GLsizei height_;
+    GLsizei layers_;
+    GLuint textureId_{};
+    PixelUnpackRing staging_;
+    std::vector<GLsizei> free_layers_;
+    uint64_t revision_{};
+};
 
-        for (auto i = 0; i < elements.size(); i++) {
-            auto const& element = elements[i];
-            glEnableVertexAttribArray(i);
-            glVertexAttribPointer(
-                i, static_cast<GLint>(element.count), element.type,
-                element.normalized, static_cast<GLsizei>(layout.get_stride()),
-                reinterpret_cast<void const*>(element.offset));  // NOLINT
+enum class YuvLayout : uint8_t {
+    I420,  // Y, U, V planes; chroma subsampled 2x2
+    NV12,  // Y plane, interleaved UV plane; chroma subsampled 2x2
+    NV21,  // Y plane, interleaved VU plane; chroma subsampled 2x2
+};
+
+// All planes of a YUV frame, sized for their subsampling and uploaded from
+// one contiguous frame through one shared staging ring. Planes are laid out
+// back to back, each chroma plane following on from the one before it, as
+// decoders emit them.
+struct YuvTexture {
+    struct Plane {
+        GLuint texture;
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        int bytes_per_pixel;
+    };
+
+    YuvTexture(YuvLayout layout,
+               GLsizei width,
+               GLsizei height,
+               size_t staging_depth = PixelUnpackRing::default_depth)
+        : layout_(layout)
+        , width_(width)
+        , height_(height)
+        , planes_(make_planes(layout, width, height))
+        , staging_(frame_size(width), staging_depth) {
+        for (auto& plane : std::span{planes_}.first(plane_count())) {
+            glGenTextures(1, &plane.texture);
+            gl_state().bind_texture(GL_TEXTURE_2D, plane.texture);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                            GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                            GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            glTexImage2D(GL_TEXTURE_2D, 0,
+                         plane.format == GL_RG ? GL_RG8 : GL_R8, plane.width,
+                         plane.height, 0, plane.format, GL_UNSIGNED_BYTE,
+                         nullptr);
         }
-        unbind();
     }
 
-    ~VertexArray() {
-        glDeleteVertexArrays(1, &vao_);
+    ~YuvTexture() {
+        for (auto const& plane : get_planes()) {
+            gl_state().forget_texture(plane.texture);
+            glDeleteTextures(1, &plane.texture);
+        }
     }
-    VertexArray(VertexArray const&)            = delete;
-    VertexArray& operator=(VertexArray const&) = delete;
 
-    VertexArray(VertexArray&& other) noexcept
-        : vao_(std::exchange(other.vao_, 0)) {
+    YuvTexture(YuvTexture const&)            = delete;
+    YuvTexture& operator=(YuvTexture const&) = delete;
+
+    YuvTexture(YuvTexture&& other) noexcept
+        : layout_(other.layout_)
+        , width_(other.width_)
+        , height_(other.height_)
+        , planes_(std::exchange(other.planes_, {}))
+        , staging_(std::move(other.staging_))
+        , revision_(other.revision_) {
     }
 
-    VertexArray& operator=(VertexArray&& other) noexcept {
-        std::ranges::swap(other.vao_, vao_);
+    YuvTexture& operator=(YuvTexture&& other) noexcept {
+        std::ranges::swap(other.layout_, layout_);
+        std::ranges::swap(other.width_, width_);
+        std::ranges::swap(other.height_, height_);
+        std::ranges::swap(other.planes_, planes_);
+        std::ranges::swap(other.staging_, staging_);
+        std::ranges::swap(other.revision_, revision_);
         return *this;
     }
 
-    auto bind() const -> void {
-        glBindVertexArray(vao_);
+    // Binds plane i to texture unit `first_unit + i`.
+    auto bind(GLenum first_unit = GL_TEXTURE0) const -> void {
+        auto unit = first_unit;
+        for (auto const& plane : get_planes()) {
+            gl_state().bind_texture(unit++, GL_TEXTURE_2D, plane.texture);
+        }
     }
 
-    auto unbind() const -> void {
-        glBindVertexArray(0);
+    // Maps the staging buffer for a whole frame whose luma rows are `pitch`
+    // bytes apart (defaults to the width). Use plane_offset()/plane_pitch()
+    // to find where each plane goes.
+    // Throws on a pitch some plane cannot be unpacked with, before mapping.
+    [[nodiscard]] auto begin_upload(int pitch = 0) -> UploadFrame {
+        if (pitch <= 0) {
+            pitch = width_;
+        }
+        (void)unpack_layouts_of(pitch);
+        return {staging_, frame_size(pitch), pitch};
     }
 
-private:
-    std::shared_ptr<VertexBuffer> vbo_;
-    GLuint vao_;
-};
-
-template <int format =
-              GL_RGBA>  // TODO: Unsized formats only for now and GL_R8/GL_RED
-    requires(format == GL_RGBA || format == GL_RGB || format == GL_RED)
-struct Texture {
-    Texture(GLsizei width, GLsizei height)
-        : width_(width), height_(height) {  // TODO: Stronger types
-        if constexpr (format == GL_RGBA) {
-            buffer_size_ = static_cast<size_t>(width_ * height_ * 4);
-        } else if constexpr (format == GL_RGB) {
-            buffer_size_ = static_cast<size_t>(width_ * height_ * 3);
-        } else if constexpr (format == GL_RED) {
-            buffer_size_ = static_cast<size_t>(width_ * height_ * 1);
+    // Throws with the frame still mapped on a pitch some plane cannot be
+    // unpacked with, or a frame too small for its planes.
+    auto commit(UploadFrame const& frame) -> void {
+        auto layouts = unpack_layouts_of(frame.pitch());
+        check_frame_size(frame.size(), frame.pitch());
+        staging_.unmap();
+
+        for (size_t i = 0; i < plane_count(); i++) {
+            auto const& plane = planes_[i];
+
+            gl_state().bind_texture(GL_TEXTURE_2D, plane.texture);
+            detail::set_unpack_layout(layouts[i]);
+            glTexSubImage2D(
+                GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height,
+                plane.format, GL_UNSIGNED_BYTE,
+                reinterpret_cast<void const*>(  // NOLINT
+                    plane_offset(i, frame.pitch())));
         }
-        glGenBuffers(1, &pbo_);
-        glGenTextures(1, &textureId_);
-        bind();
+        staging_.fence();
+        revision_++;
+        detail::count_upload(frame.size());
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        detail::reset_unpack_layout();
 
-        if constexpr (format == GL_RGBA || format == GL_RGB) {
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                         GL_UNSIGNED_BYTE, nullptr);
-        } else if constexpr (format == GL_RED) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, format,
-                         GL_UNSIGNED_BYTE, nullptr);
-        }
-        unbind();
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
     }
 
-    auto bind() -> void {
-        glBindTexture(GL_TEXTURE_2D, textureId_);
-    }
-    auto unbind() -> void {
-        glBindTexture(GL_TEXTURE_2D, 0);
+    // `data` holds every plane back to back; `pitch` is the luma pitch.
+    auto copy_data(std::span<std::byte const> data, int pitch) -> void {
+        CpuZone zone{"copy_data"};
+        if (pitch <= 0) {
+            pitch = width_;
+        }
+        (void)unpack_layouts_of(pitch);
+        check_frame_size(data.size(), pitch);
+        UploadFrame frame{staging_, data.size(), pitch};
+        std::memcpy(frame.data(), data.data(), data.size());
+        commit(frame);
     }
 
-    auto copy_data(std::span<std::byte const> data, int pitch) {
-        bind();
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        int bytes_per_pixel = 0;
-        if constexpr (format == GL_RGBA) {
-            bytes_per_pixel = 4;
-        } else if constexpr (format == GL_RGB) {
-            bytes_per_pixel = 3;
-        } else if constexpr (format == GL_RED) {
-            bytes_per_pixel = 1;
+    auto plane_pitch(size_t plane, int pitch) const -> int {
+        if (plane == 0) {
+            return pitch;
         }
-
-        if (bytes_per_pixel > 0 && pitch > 0) {
-            glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / bytes_per_pixel);
+        if (layout_ == YuvLayout::I420) {
+            return (pitch + 1) / 2;
         }
+        return (pitch + 1) & ~1;
+    }
 
-        glBufferData(GL_PIXEL_UNPACK_BUFFER, data.size(), data.data(),
-                     GL_STREAM_DRAW);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, format,
-                        GL_UNSIGNED_BYTE, static_cast<void*>(nullptr));
+    auto plane_offset(size_t plane, int pitch) const -> size_t {
+        size_t offset = 0;
+        for (size_t i = 0; i < plane; i++) {
+            offset += static_cast<size_t>(plane_pitch(i, pitch)) *
+                      static_cast<size_t>(planes_[i].height);
+        }
+        return offset;
+    }
 
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    auto frame_size(int pitch) const -> size_t {
+        return plane_offset(plane_count(), pitch);
+    }
 
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-        unbind();
+    auto plane_count() const noexcept -> size_t {
+        return layout_ == YuvLayout::I420 ? 3 : 2;
     }
 
-    ~Texture() {
-        glDeleteTextures(1, &textureId_);
-        glDeleteBuffers(1, &pbo_);
+    auto get_planes() const -> std::span<Plane const> {
+        return std::span{planes_}.first(plane_count());
     }
-    Texture(Texture const&)            = delete;
-    Texture& operator=(Texture const&) = delete;
 
-    Texture(Texture&& other) noexcept
-        : textureId_(std::exchange(other.textureId_, 0))
-        , pbo_(std::exchange(other.pbo_, 0)) {
+    auto get_layout() const noexcept -> YuvLayout {
+        return layout_;
     }
 
-    Texture& operator=(Texture&& other) noexcept {
-        std::ranges::swap(other.textureId_, textureId_);
-        std::ranges::swap(other.pbo_, pbo_);
-        return *this;
+    // Bumped by every commit, so damage tracking can tell new contents apart.
+    auto get_revision() const noexcept -> uint64_t {
+        return revision_;
     }
 
 private:
+    auto unpack_layouts_of(int pitch) const
+        -> std::array<detail::UnpackLayout, 3> {
+        std::array<detail::UnpackLayout, 3> layouts{};
+        for (size_t i = 0; i < plane_count(); i++) {
+            layouts[i] = detail::unpack_layout_of(plane_pitch(i, pitch),
+                                                  planes_[i].width,
+                                                  planes_[i].bytes_per_pixel);
+        }
+        return layouts;
+    }
+
+    auto check_frame_size(size_t size, int pitch) const -> void {
+        if (size < frame_size(pitch)) {
+            throw std::runtime_error(
+                fmt::format("YUV frame too small: {} bytes, expected {}", size,
+                            frame_size(pitch)));
+        }
+    }
+
+    static auto make_planes(YuvLayout layout, GLsizei width, GLsizei height)
+        -> std::array<Plane, 3> {
+        GLsizei chroma_width  = (width + 1) / 2;
+        GLsizei chroma_height = (height + 1) / 2;
+
+        if (layout == YuvLayout::I420) {
+            return {
+                Plane{0, width, height, GL_RED, 1},
+                Plane{0, chroma_width, chroma_height, GL_RED, 1},
+                Plane{0, chroma_width, chroma_height, GL_RED, 1},
+            };
+        }
+        return {
+            Plane{0, width, height, GL_RED, 1},
+            Plane{0, chroma_width, chroma_height, GL_RG, 2},
+            Plane{},
+        };
+    }
+
+    YuvLayout layout_;
     GLsizei width_;
     GLsizei height_;
-    GLuint textureId_;
-    GLuint pbo_;
-    size_t buffer_size_;
+    std::array<Plane, 3> planes_;
+    PixelUnpackRing staging_;
+    uint64_t revision_{};
 };
 
+// Defined in external_texture.h, with WNLRENDERER_EGL.
+struct ExternalTexture;
+
 template <typename T, typename M>
     requires std::is_standard_layout_v<T>
 constexpr size_t checked_offset_of(M T::* member) {
@@ -435,30 +2513,130 @@ struct Vertex {
     }
 };
 
+// 8 byte vertex for flat meshes within [-1, 1]: snorm16 position and
+// unorm16 uv, read by the same shaders as Vertex (z = 0, w = 1).
+struct Vertex2D {
+    std::array<int16_t, 2> position;
+    std::array<uint16_t, 2> uv;
+
+    static constexpr auto make(glm::vec2 position, glm::vec2 uv) -> Vertex2D {
+        return {
+            {to_snorm16(position.x), to_snorm16(position.y)},
+            {to_unorm16(uv.x), to_unorm16(uv.y)}
+        };
+    }
+
+    static renderer::VertexBufferLayout getLayout() {
+        renderer::VertexBufferLayout layout;
+        layout.set_stride(sizeof(Vertex2D));
+
+        layout.push<int16_t>(2, checked_offset_of(&Vertex2D::position));
+        layout.push<uint16_t>(2, checked_offset_of(&Vertex2D::uv));
+
+        return layout;
+    }
+};
+
+template <typename V>
+concept MeshVertex = requires {
+    { V::getLayout() } -> std::same_as<VertexBufferLayout>;
+};
+
 struct Mesh {
-    Mesh(std::span<Vertex const> vertices, std::span<uint32_t const> indices) {
+    Mesh(std::span<Vertex const> vertices, std::span<uint32_t const> indices)
+        : Mesh(std::as_bytes(vertices), Vertex::getLayout(), indices) {
+    }
+
+    template <MeshVertex V, size_t N>
+    Mesh(std::span<V const, N> vertices, std::span<uint32_t const> indices)
+        : Mesh(std::as_bytes(vertices), V::getLayout(), indices) {
+    }
+
+    Mesh(std::span<std::byte const> vertices,
+         VertexBufferLayout layout,
+         std::span<uint32_t const> indices)
+        : layout_(std::move(layout)) {
         vertex_buffer_ = std::make_shared<renderer::VertexBuffer>();
-        vertex_buffer_->set_data(std::as_bytes(vertices));
+        vertex_buffer_->set_data(vertices);
 
         index_buffer_ = std::make_shared<renderer::IndexBuffer>();
         index_buffer_->set_data(indices);
 
-        vertex_array_ = std::make_unique<renderer::VertexArray>(
-            vertex_buffer_, decltype(vertices)::value_type::getLayout());
+        record_vertex_array();
+    }
+
+    // Mesh over the same buffers for another context of the share group.
+    // Buffers are shared between contexts but VAOs are not, so call this with
+    // the context that will draw the result current.
+    auto share() const -> std::shared_ptr<Mesh> {
+        return std::shared_ptr<Mesh>(
+            new Mesh(vertex_buffer_, index_buffer_, layout_));
     }
 
     auto draw() -> void {
         vertex_array_->bind();
-        index_buffer_->bind();
+        if (instance_attributes_ != 0) {
+            // Instance inputs fall back to their constant attribute values.
+            vertex_array_->disable_attributes(attribute::transform,
+                                              instance_attributes_);
+            instance_attributes_ = 0;
+        }
         glDrawElements(GL_TRIANGLES,
                        static_cast<GLsizei>(index_buffer_->get_count()),
                        GL_UNSIGNED_INT, nullptr);
+        detail::count_draw_call();
+    }
+
+    // Draws `count` instances, sourcing per-instance attributes from
+    // `instances` starting `base_offset` bytes in (GLES has no base instance).
+    auto draw_instanced(VertexBuffer const& instances,
+                        VertexBufferLayout const& layout,
+                        size_t base_offset,
+                        GLsizei count) -> void {
+        draw_instanced(instances.get_id(), layout, base_offset, count);
+    }
+
+    // As above, for instances in any GL_ARRAY_BUFFER, e.g. a BufferRing.
+    auto draw_instanced(GLuint instances,
+                        VertexBufferLayout const& layout,
+                        size_t base_offset,
+                        GLsizei count) -> void {
+        vertex_array_->bind();
+        vertex_array_->set_instance_attributes(instances, layout,
+                                               attribute::transform,
+                                               base_offset);
+        instance_attributes_ = layout.get_elements().size();
+        glDrawElementsInstanced(
+            GL_TRIANGLES, static_cast<GLsizei>(index_buffer_->get_count()),
+            GL_UNSIGNED_INT, nullptr, count);
+        detail::count_draw_call();
     }
 
 private:
+    Mesh(std::shared_ptr<renderer::VertexBuffer> vertex_buffer,
+         std::shared_ptr<renderer::IndexBuffer> index_buffer,
+         VertexBufferLayout layout)
+        : vertex_buffer_(std::move(vertex_buffer))
+        , index_buffer_(std::move(index_buffer))
+        , layout_(std::move(layout)) {
+        record_vertex_array();
+    }
+
+    auto record_vertex_array() -> void {
+        vertex_array_ =
+            std::make_unique<renderer::VertexArray>(vertex_buffer_, layout_);
+
+        // Record the index buffer in the VAO so draws only bind the VAO.
+        vertex_array_->bind();
+        index_buffer_->bind();
+        vertex_array_->unbind();
+    }
+
     std::unique_ptr<renderer::VertexArray> vertex_array_;
     std::shared_ptr<renderer::VertexBuffer> vertex_buffer_;
     std::shared_ptr<renderer::IndexBuffer> index_buffer_;
+    VertexBufferLayout layout_;
+    size_t instance_attributes_{};
 };
 
 // NOLINTBEGIN
@@ -476,10 +2654,33 @@ constexpr std::array<uint32_t, 6> indices{
     2, 1, 3   // Second Triangle
 };
 
+constexpr std::array<renderer::Vertex2D const, 4> vertices_2d{
+    Vertex2D::make({-0.5F, 0.5F}, {0.0F, 1.0F}),
+    Vertex2D::make({-0.5F, -0.5F}, {0.0F, 0.0F}),
+    Vertex2D::make({0.5F, 0.5F}, {1.0F, 1.0F}),
+    Vertex2D::make({0.5F, -0.5F}, {1.0F, 0.0F}),
+};
+
 inline auto QuadMesh() -> Mesh {
     return {vertices, indices};
 }
 
+inline auto QuadMesh2D() -> Mesh {
+    return {std::span{vertices_2d}, std::span{indices}};
+}
+
+// translate(position) * scale(scale.x, scale.y, 0) for a flat quad, written
+// straight into the matrix instead of multiplying two mat4s.
+inline auto compose_2d(glm::vec3 const& position, glm::vec2 const& scale)
+    -> glm::mat4 {
+    glm::mat4 transform{1.0F};
+    transform[0][0] = scale.x;
+    transform[1][1] = scale.y;
+    transform[2][2] = 0.0F;
+    transform[3]    = glm::vec4{position.x, position.y, position.z, 1.0F};
+    return transform;
+}
+
 struct PositionTopLeft_t {};
 struct PositionCenter_t {};
 
@@ -489,11 +2690,24 @@ constexpr PositionCenter_t PositionCenter{};
 template <int format = GL_RGBA>
     requires(format == GL_RGBA || format == GL_RGB || format == GL_RED)
 struct Renderable {
+    // Samples one layer of a shared texture array; the layer is passed to the
+    // shader through `a_layer`. Drawn on its own, it needs a vertex shader
+    // taking the transform from u_Transform rather than `a_transform`.
+    Renderable(std::shared_ptr<Mesh> mesh,
+               std::shared_ptr<TextureArray<format>> texture_array,
+               GLsizei layer)
+        requires(format != GL_RED)
+        : mesh_(std::move(mesh))
+        , source_(std::move(texture_array))
+        , layer_(layer)
+        , transform_(1.0F) {
+    }
+
     Renderable(std::shared_ptr<Mesh> mesh,
                std::shared_ptr<Texture<format>> texture)
         requires(format != GL_RED)
         : mesh_(std::move(mesh))
-        , texture_y(std::move(texture))
+        , source_(std::move(texture))
         , transform_(1.0F) {
     }
 
@@ -503,70 +2717,129 @@ struct Renderable {
                std::shared_ptr<Texture<format>> texture_v)
         requires(format == GL_RED)
         : mesh_(std::move(mesh))
-        , texture_y(std::move(texture_y))
-        , texture_u(std::move(texture_u))
-        , texture_v(std::move(texture_v))
+        , source_(PlanarTextures{std::move(texture_y), std::move(texture_u),
+                                 std::move(texture_v)})
         , transform_(1.0F) {
     }
 
-    void set_position(PositionCenter_t /*unused*/, glm::vec3 const& position) {
-        position_ = position;
+    // Semi-planar (NV12/NV21) frame held in separate luma and chroma textures.
+    Renderable(std::shared_ptr<Mesh> mesh,
+               std::shared_ptr<Texture<format>> texture_y,
+               std::shared_ptr<Texture<GL_RG>> texture_uv)
+        requires(format == GL_RED)
+        : mesh_(std::move(mesh))
+        , source_(SemiPlanarTextures{std::move(texture_y),
+                                     std::move(texture_uv)})
+        , transform_(1.0F) {
+    }
 
-        dirty_ = true;
+    Renderable(std::shared_ptr<Mesh> mesh, std::shared_ptr<YuvTexture> texture)
+        requires(format == GL_RED)
+        : mesh_(std::move(mesh))
+        , source_(std::move(texture))
+        , transform_(1.0F) {
     }
 
-    void set_position(PositionTopLeft_t /*unused*/, glm::vec3 const& position) {
-        position_.x = position.x + (scale_.x / 2.0F);
-        position_.y = position.y + (scale_.y / 2.0F);
-        position_.z = position.z;
+#ifdef WNLRENDERER_EGL
+    // Imported dmabuf: GL_RED for ExternalSampling::Planes with the YUV
+    // shaders, another format for ExternalSampling::External.
+    Renderable(std::shared_ptr<Mesh> mesh,
+               std::shared_ptr<ExternalTexture> texture)
+        : mesh_(std::move(mesh))
+        , source_(std::move(texture))
+        , transform_(1.0F) {
+    }
+#endif
+
+    void set_position(PositionCenter_t /*unused*/, glm::vec3 const& position) {
+        if (position_ != position) {
+            position_ = position;
+            dirty_    = true;
+            revision_++;
+        }
+    }
 
-        dirty_ = true;
+    void set_position(PositionTopLeft_t /*unused*/, glm::vec3 const& position) {
+        set_position(PositionCenter,
+                     {position.x + (scale_.x / 2.0F),
+                      position.y + (scale_.y / 2.0F), position.z});
     }
 
     void set_scale(glm::vec2 scale) {
-        scale_ = scale;
-        dirty_ = true;
+        if (scale_ != scale) {
+            scale_ = scale;
+            dirty_ = true;
+            revision_++;
+        }
     }
 
-    auto draw(ShaderProgram& shader) -> void
-        requires(format != GL_RED)
-    {
+    // Opaque renderables hide whatever they fully cover (see
+    // BatchRenderer::cull()). Only GL_RGBA ones start out translucent.
+    auto set_opaque(bool opaque) -> void {
+        opaque_ = opaque;
+    }
+
+    auto is_opaque() const noexcept -> bool {
+        return opaque_;
+    }
+
+    // Changes whenever what this draws may have: it moved, was resized or one
+    // of its textures got new contents.
+    auto get_revision() const -> uint64_t {
+        auto sources = std::visit(
+            [](auto const& source) { return revision_of(source); }, source_);
+        return revision_ + sources;
+    }
+
+    auto draw(ShaderProgram& shader) -> void {
+        draw_with([&] { shader.set<"u_Transform">(get_transform()); });
+    }
+
+    // Draws with the transform taken from slot `index` of the frame's
+    // DrawUniforms, for programs declaring that block.
+    auto draw(UniformRing<DrawUniforms> const& uniforms, size_t index)
+        -> void {
+        draw_with([&] { uniforms.bind(index); });
+    }
+
+    // Recomputed only after the position or scale changed.
+    auto get_transform() -> glm::mat4 const& {
         if (dirty_) {
-            glm::mat4 transMatrix = glm::translate(glm::mat4(1.0F), position_);
-            glm::mat4 scaleMatrix = glm::scale(
-                glm::mat4(1.0F), glm::vec3(scale_.x, scale_.y, 0.0F));
+            transform_ = compose_2d(position_, scale_);
+            dirty_     = false;
+        }
+        return transform_;
+    }
+
+    // Binds the textures to the units their samplers are pinned to (see
+    // sampler_units).
+    auto bind_textures() const -> void {
+        std::visit([](auto const& source) { bind_source(source); }, source_);
+    }
 
-            transform_ = transMatrix * scaleMatrix;
+    // Target every texture of get_texture_ids() is bound to.
+    auto get_texture_target() const -> GLenum {
+#ifdef WNLRENDERER_EGL
+        if (auto const& external = get_external_texture()) {
+            return external->get_target();
         }
-        glActiveTexture(GL_TEXTURE0);
-        texture_y->bind();
-        shader.set_int("u_texture", 0);
-        shader.set_mat4("u_Transform", transform_);
-        mesh_->draw();
+#endif
+        return samples_array() ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
     }
 
-    auto draw(ShaderProgram& shader) -> void
-        requires(format == GL_RED)
-    {
-        if (dirty_) {
-            glm::mat4 transMatrix = glm::translate(glm::mat4(1.0F), position_);
-            glm::mat4 scaleMatrix = glm::scale(
-                glm::mat4(1.0F), glm::vec3(scale_.x, scale_.y, 0.0F));
-
-            transform_ = transMatrix * scaleMatrix;
-        }
-        glActiveTexture(GL_TEXTURE0);
-        texture_y->bind();
-        glActiveTexture(GL_TEXTURE1);
-        texture_u->bind();
-        glActiveTexture(GL_TEXTURE2);
-        texture_v->bind();
-
-        shader.set_int("u_texture_y", 0);
-        shader.set_int("u_texture_u", 1);
-        shader.set_int("u_texture_v", 2);
-        shader.set_mat4("u_Transform", transform_);
-        mesh_->draw();
+    // Texture names bound by bind_textures(), used to group draws that can
+    // share a bind.
+    auto get_texture_ids() const -> std::array<GLuint, 3> {
+        return std::visit([](auto const& source) { return ids_of(source); },
+                          source_);
+    }
+
+    auto get_mesh() const -> std::shared_ptr<Mesh> const& {
+        return mesh_;
+    }
+
+    auto get_layer() const noexcept -> float {
+        return static_cast<float>(layer_);
     }
 
     auto get_size() const
@@ -587,40 +2860,189 @@ struct Renderable {
         return std::make_pair(std::round(top_left_x), std::round(top_left_y));
     }
 
-    auto get_texture() const -> std::shared_ptr<Texture<format>>
+    // Getters for each kind of source; all but the one passed to the
+    // constructor come back empty.
+    auto get_texture() const -> std::shared_ptr<Texture<format>> const&
         requires(format != GL_RED)
     {
-        return texture_y;
+        return source_as<std::shared_ptr<Texture<format>>>();
     }
 
+    // The luma texture alone for a semi-planar frame.
     auto get_texture() const
-        -> std::tuple<std::shared_ptr<Texture<format>>,  // TODO: Stronger types
-                      std::shared_ptr<Texture<format>>,
-                      std::shared_ptr<Texture<format>>>
+        -> std::tuple<std::shared_ptr<Texture<format>> const&,
+                      std::shared_ptr<Texture<format>> const&,
+                      std::shared_ptr<Texture<format>> const&>
+        requires(format == GL_RED)
+    {
+        static std::shared_ptr<Texture<format>> const none;
+        if (auto const* planes = std::get_if<SemiPlanarTextures>(&source_)) {
+            return {planes->y, none, none};
+        }
+        auto const& planes = source_as<PlanarTextures>();
+        return {planes.y, planes.u, planes.v};
+    }
+
+    auto get_yuv_texture() const -> std::shared_ptr<YuvTexture> const&
         requires(format == GL_RED)
     {
-        return std::make_tuple(texture_y, texture_u, texture_v);
+        return source_as<std::shared_ptr<YuvTexture>>();
+    }
+
+    auto get_texture_array() const
+        -> std::shared_ptr<TextureArray<format>> const&
+        requires(format != GL_RED)
+    {
+        return source_as<std::shared_ptr<TextureArray<format>>>();
+    }
+
+#ifdef WNLRENDERER_EGL
+    auto get_external_texture() const
+        -> std::shared_ptr<ExternalTexture> const& {
+        return source_as<std::shared_ptr<ExternalTexture>>();
     }
+#endif
 
     constexpr auto get_format() const -> int {
         return format;
     }
 
 private:
+    struct PlanarTextures {
+        std::shared_ptr<Texture<format>> y;
+        std::shared_ptr<Texture<format>> u;
+        std::shared_ptr<Texture<format>> v;
+    };
+
+    struct SemiPlanarTextures {
+        std::shared_ptr<Texture<format>> y;
+        std::shared_ptr<Texture<GL_RG>> uv;
+    };
+
+    // What the renderable samples, which the constructor fixes. The planar
+    // sources and YuvTexture only go with GL_RED, a texture array with the
+    // other formats.
+    using Source = std::variant<std::shared_ptr<Texture<format>>,
+                                PlanarTextures,
+                                SemiPlanarTextures,
+                                std::shared_ptr<YuvTexture>,
+#ifdef WNLRENDERER_EGL
+                                std::shared_ptr<ExternalTexture>,
+#endif
+                                std::shared_ptr<TextureArray<format>>>;
+
+    template <typename T>
+    auto source_as() const -> T const& {
+        static T const none{};
+        auto const* source = std::get_if<T>(&source_);
+        return source != nullptr ? *source : none;
+    }
+
+    auto samples_array() const -> bool {
+        return std::holds_alternative<std::shared_ptr<TextureArray<format>>>(
+            source_);
+    }
+
+    template <typename T>
+    static auto revision_of(std::shared_ptr<T> const& texture) -> uint64_t {
+        return texture ? texture->get_revision() : 0;
+    }
+
+    static auto revision_of(PlanarTextures const& planes) -> uint64_t {
+        return revision_of(planes.y) + revision_of(planes.u) +
+               revision_of(planes.v);
+    }
+
+    static auto revision_of(SemiPlanarTextures const& planes) -> uint64_t {
+        return revision_of(planes.y) + revision_of(planes.uv);
+    }
+
+    template <typename T>
+    static auto bind_source(std::shared_ptr<T> const& texture) -> void {
+        if constexpr (std::is_same_v<T, YuvTexture> ||
+                      std::is_same_v<T, ExternalTexture>) {
+            texture->bind(GL_TEXTURE0);
+        } else {
+            gl_state().active_texture(GL_TEXTURE0);
+            texture->bind();
+        }
+    }
+
+    static auto bind_source(PlanarTextures const& planes) -> void {
+        gl_state().active_texture(GL_TEXTURE0);
+        planes.y->bind();
+        gl_state().active_texture(GL_TEXTURE1);
+        planes.u->bind();
+        gl_state().active_texture(GL_TEXTURE2);
+        planes.v->bind();
+    }
+
+    static auto bind_source(SemiPlanarTextures const& planes) -> void {
+        gl_state().active_texture(GL_TEXTURE0);
+        planes.y->bind();
+        gl_state().active_texture(GL_TEXTURE1);
+        planes.uv->bind();
+    }
+
+    template <typename T>
+    static auto ids_of(std::shared_ptr<T> const& texture)
+        -> std::array<GLuint, 3> {
+        std::array<GLuint, 3> ids{};
+        if constexpr (std::is_same_v<T, YuvTexture> ||
+                      std::is_same_v<T, ExternalTexture>) {
+            auto planes = texture->get_planes();
+            for (size_t i = 0; i < planes.size(); i++) {
+                ids[i] = planes[i].texture;
+            }
+        } else {
+            ids[0] = texture->get_id();
+        }
+        return ids;
+    }
+
+    static auto ids_of(PlanarTextures const& planes) -> std::array<GLuint, 3> {
+        return {planes.y->get_id(), planes.u->get_id(), planes.v->get_id()};
+    }
+
+    static auto ids_of(SemiPlanarTextures const& planes)
+        -> std::array<GLuint, 3> {
+        return {planes.y->get_id(), planes.uv->get_id(), 0};
+    }
+
+    // Everything but how the transform reaches the shader.
+    template <typename SetTransform>
+    auto draw_with(SetTransform set_transform) -> void {
+        CpuZone zone{"Renderable::draw"};
+        bind_textures();
+        if (samples_array()) {
+            glVertexAttrib1f(attribute::layer, get_layer());
+        }
+        set_transform();
+        mesh_->draw();
+    }
+
     std::shared_ptr<Mesh> mesh_;
-    std::shared_ptr<Texture<format>> texture_y;
-    std::shared_ptr<Texture<format>> texture_u;
-    std::shared_ptr<Texture<format>> texture_v;
+    Source source_;
+    GLsizei layer_{};
 
-    glm::vec3 position_;
-    glm::vec2 scale_;
+    glm::vec3 position_{};
+    glm::vec2 scale_{};
     glm::mat4 transform_;
 
     bool dirty_{};
+    bool opaque_{format != GL_RGBA};
+    uint64_t revision_{};
 };
 
 template <int format>
 Renderable(std::shared_ptr<Mesh> mesh, std::shared_ptr<Texture<format>> texture)
     -> Renderable<format>;
 
+Renderable(std::shared_ptr<Mesh> mesh, std::shared_ptr<YuvTexture> texture)
+    -> Renderable<GL_RED>;
+
 };  // namespace renderer
+
+#ifdef WNLRENDERER_EGL
+#include <wnlrenderer/external_texture.h>
+#endif
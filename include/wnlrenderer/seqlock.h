@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace renderer {
+
+// Single-writer value that readers on other threads copy without locking and
+// without ever observing a half-written value. The writer never waits; a
+// reader retries while a store is in progress.
+template <typename T>
+    requires(std::is_trivially_copyable_v<T> &&
+             std::is_default_constructible_v<T>)
+struct SeqLock {
+    SeqLock() = default;
+
+    explicit SeqLock(T const& value) {
+        write(value);
+    }
+
+    // Writer side.
+    auto store(T const& value) -> void {
+        auto sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        write(value);
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    auto load() const -> T {
+        std::array<Word, words> raw{};
+        for (;;) {
+            auto before = sequence_.load(std::memory_order_acquire);
+            if ((before & 1U) != 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < words; i++) {
+                raw[i] = data_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        T value;
+        std::memcpy(static_cast<void*>(&value), raw.data(), sizeof(T));
+        return value;
+    }
+
+    // Number of completed stores; cheap enough to poll every frame and only
+    // load() when it changes.
+    auto version() const -> uint64_t {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    using Word = uint64_t;
+
+    static constexpr size_t words =
+        (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    auto write(T const& value) -> void {
+        std::array<Word, words> raw{};
+        std::memcpy(raw.data(), &value, sizeof(T));
+        for (size_t i = 0; i < words; i++) {
+            data_[i].store(raw[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> sequence_{0};
+    std::array<std::atomic<Word>, words> data_{};
+};
+
+};  // namespace renderer
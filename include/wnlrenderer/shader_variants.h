@@ -0,0 +1,214 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <wnlrenderer/renderer.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <stdexcept>
+#include <string_view>
+
+namespace renderer {
+
+enum class ColorMatrix : uint8_t {
+    bt601,
+    bt709,
+};
+
+enum class ColorRange : uint8_t {
+    full,     // 0-255
+    limited,  // luma 16-235, chroma 16-240
+};
+
+namespace detail::variant {
+// rgb = matrix * yuv + offset, with yuv as sampled from 8-bit planes.
+// Column-major, as GLSL takes it.
+struct Conversion {
+    std::array<double, 9> matrix;
+    std::array<double, 3> offset;
+};
+
+constexpr auto conversion_of(ColorMatrix matrix, ColorRange range)
+    -> Conversion {
+    double kr = matrix == ColorMatrix::bt601 ? 0.299 : 0.2126;
+    double kb = matrix == ColorMatrix::bt601 ? 0.114 : 0.0722;
+    double kg = 1.0 - kr - kb;
+
+    bool limited        = range == ColorRange::limited;
+    double luma_scale   = limited ? 255.0 / 219.0 : 1.0;
+    double chroma_scale = limited ? 255.0 / 224.0 : 1.0;
+    double luma_bias    = limited ? 16.0 / 255.0 : 0.0;
+    double chroma_bias  = 128.0 / 255.0;
+
+    Conversion conversion{{
+                              luma_scale,
+                              luma_scale,
+                              luma_scale,
+                              0.0,
+                              -2.0 * kb * (1.0 - kb) / kg * chroma_scale,
+                              2.0 * (1.0 - kb) * chroma_scale,
+                              2.0 * (1.0 - kr) * chroma_scale,
+                              -2.0 * kr * (1.0 - kr) / kg * chroma_scale,
+                              0.0,
+                          },
+                          {}};
+    auto const& m = conversion.matrix;
+    for (size_t row = 0; row < 3; row++) {
+        conversion.offset[row] = -(m[row] * luma_bias +
+                                   m[3 + row] * chroma_bias +
+                                   m[6 + row] * chroma_bias);
+    }
+    return conversion;
+}
+
+// Just enough of a string for assembling GLSL at compile time.
+template <size_t N>
+struct ConstexprString {
+    constexpr auto append(std::string_view text) -> ConstexprString& {
+        for (char c : text) {
+            data[size++] = c;
+        }
+        return *this;
+    }
+
+    // Fixed-point with six decimals, always with a point, as GLSL ES 1.00
+    // wants for float literals.
+    constexpr auto append(double value) -> ConstexprString& {
+        if (value < 0.0) {
+            append("-");
+            value = -value;
+        }
+        auto scaled = static_cast<uint64_t>(value * 1e6 + 0.5);
+        append_digits(scaled / 1000000, 1);
+        append(".");
+        return append_digits(scaled % 1000000, 6);
+    }
+
+    constexpr auto append_digits(uint64_t value, int min_digits)
+        -> ConstexprString& {
+        std::array<char, 20> digits{};
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0 || count < min_digits);
+        while (count > 0) {
+            data[size++] = digits[--count];
+        }
+        return *this;
+    }
+
+    constexpr auto view() const -> std::string_view {
+        return {data.data(), size};
+    }
+
+    std::array<char, N> data{};
+    size_t size{};
+};
+
+// The same shape as the hand-written YUV shaders, with the conversion
+// folded into constants: one matrix multiply and add, no branches.
+template <YuvLayout layout, ColorMatrix matrix, ColorRange range>
+constexpr auto build_fragment_shader() -> ConstexprString<2048> {
+    constexpr auto conversion = conversion_of(matrix, range);
+
+    ConstexprString<2048> source;
+    source.append("\nprecision mediump float;\n\n"
+                  "uniform sampler2D u_texture_y;\n");
+    if constexpr (layout == YuvLayout::I420) {
+        source.append("uniform sampler2D u_texture_u;\n"
+                      "uniform sampler2D u_texture_v;\n");
+    } else {
+        source.append("uniform sampler2D u_texture_uv;\n");
+    }
+    source.append("\nvarying vec2 v_texCoord;\n\n"
+                  "const mat3 yuv_to_rgb = mat3(");
+    for (size_t i = 0; i < conversion.matrix.size(); i++) {
+        source.append(i == 0 ? "" : ", ").append(conversion.matrix[i]);
+    }
+    source.append(");\nconst vec3 yuv_offset = vec3(");
+    for (size_t i = 0; i < conversion.offset.size(); i++) {
+        source.append(i == 0 ? "" : ", ").append(conversion.offset[i]);
+    }
+    source.append(");\n\n"
+                  "void main()\n"
+                  "{\n"
+                  "    vec2 flipped_uv = vec2(v_texCoord.x, 1.0 - "
+                  "v_texCoord.y);\n"
+                  "    vec3 yuv = vec3(texture2D(u_texture_y, "
+                  "flipped_uv).r,\n");
+    if constexpr (layout == YuvLayout::I420) {
+        source.append("                    texture2D(u_texture_u, "
+                      "flipped_uv).r,\n"
+                      "                    texture2D(u_texture_v, "
+                      "flipped_uv).r);\n");
+    } else {
+        source.append("                    texture2D(u_texture_uv, flipped_uv)")
+            .append(layout == YuvLayout::NV12 ? ".rg" : ".gr")
+            .append(");\n");
+    }
+    source.append("    gl_FragColor = vec4(clamp(yuv_to_rgb * yuv + "
+                  "yuv_offset, 0.0, 1.0), 1.0);\n"
+                  "}\n");
+    return source;
+}
+
+// build_fragment_shader() cut down to size, NUL-terminated for GL.
+template <YuvLayout layout, ColorMatrix matrix, ColorRange range>
+constexpr auto fragment_shader_of() {
+    constexpr auto built = build_fragment_shader<layout, matrix, range>();
+    std::array<char, built.size + 1> source{};
+    for (size_t i = 0; i < built.size; i++) {
+        source[i] = built.data[i];
+    }
+    return source;
+}
+};  // namespace detail::variant
+
+// Fragment shader and matching bind/draw policy for one YUV layout, colour
+// matrix and range, all fixed at compile time. The GLSL is generated as a
+// constant (fragment_shader pairs with vertex_shader-style programs writing
+// v_texCoord), and binding knows its plane count up front:
+//
+//   using Bt709 = YuvVariant<YuvLayout::NV12, ColorMatrix::bt709,
+//                            ColorRange::limited>;
+//   ShaderProgram program{vertex_shader, Bt709::fragment_shader};
+//   Bt709::draw(program, *texture, *mesh, transform);
+template <YuvLayout layout,
+          ColorMatrix matrix = ColorMatrix::bt601,
+          ColorRange range   = ColorRange::full>
+struct YuvVariant {
+    static constexpr size_t plane_count = layout == YuvLayout::I420 ? 3 : 2;
+
+    static constexpr auto source =
+        detail::variant::fragment_shader_of<layout, matrix, range>();
+    static constexpr char const* fragment_shader = source.data();
+
+    // Planes go to units 0 and up, where sampler_units pins the samplers.
+    static auto bind(YuvTexture const& texture) -> void {
+        if (texture.get_layout() != layout) {
+            throw std::runtime_error(
+                fmt::format("YUV variant for layout {} bound to layout {}",
+                            static_cast<int>(layout),
+                            static_cast<int>(texture.get_layout())));
+        }
+        auto planes = texture.get_planes();
+        for (size_t i = 0; i < plane_count; i++) {
+            gl_state().bind_texture(GL_TEXTURE0 + static_cast<GLenum>(i),
+                                    GL_TEXTURE_2D, planes[i].texture);
+        }
+    }
+
+    static auto draw(ShaderProgram const& program,
+                     YuvTexture const& texture,
+                     Mesh& mesh,
+                     glm::mat4 const& transform) -> void {
+        bind(texture);
+        program.set<"u_Transform">(transform);
+        mesh.draw();
+    }
+};
+
+};  // namespace renderer
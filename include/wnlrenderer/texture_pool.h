@@ -0,0 +1,185 @@
+#pragma once
+
+#include <wnlrenderer/renderer.h>
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+struct TexturePoolStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t live_count;  // handed out and not yet released
+    size_t live_bytes;
+    size_t idle_count;  // kept for reuse
+    size_t idle_bytes;
+};
+
+namespace detail {
+struct TexturePoolState {
+    struct Key {
+        int format;
+        GLsizei width;
+        GLsizei height;
+
+        auto operator<=>(Key const&) const = default;
+    };
+
+    using Owned = std::unique_ptr<void, void (*)(void*)>;
+
+    struct Idle {
+        Key key;
+        Owned texture;
+    };
+
+    TexturePoolState(size_t byte_budget, size_t depth)
+        : budget(byte_budget), staging_depth(depth) {
+    }
+
+    // Texture memory and staging buffers, as far as GL reveals it.
+    auto bytes_of(Key const& key) const -> size_t {
+        return static_cast<size_t>(key.width) *
+               static_cast<size_t>(key.height) *
+               static_cast<size_t>(bytes_per_pixel_of(key.format)) *
+               (1 + staging_depth);
+    }
+
+    // The most recently released texture matching `key`, or null. Either
+    // way, count_live() it once the caller holds a texture.
+    auto take(Key const& key) -> Owned {
+        std::scoped_lock lock{mutex};
+        for (auto it = idle.rbegin(); it != idle.rend(); ++it) {
+            if (it->key == key) {
+                auto texture = std::move(it->texture);
+                idle.erase(std::next(it).base());
+                stats.hits++;
+                stats.idle_count--;
+                stats.idle_bytes -= bytes_of(key);
+                return texture;
+            }
+        }
+        stats.misses++;
+        return {nullptr, nullptr};
+    }
+
+    auto count_live(Key const& key) -> void {
+        std::scoped_lock lock{mutex};
+        stats.live_count++;
+        stats.live_bytes += bytes_of(key);
+    }
+
+    auto give_back(Key const& key, Owned texture) -> void {
+        std::vector<Idle> evicted;
+        {
+            std::scoped_lock lock{mutex};
+            stats.live_count--;
+            stats.live_bytes -= bytes_of(key);
+            stats.idle_count++;
+            stats.idle_bytes += bytes_of(key);
+            idle.push_back({key, std::move(texture)});
+            evicted = evict(budget);
+        }
+        // Destroyed outside the lock: that is where GL gets called.
+    }
+
+    // Oldest idle textures beyond `limit` bytes, for the caller to destroy.
+    auto evict(size_t limit) -> std::vector<Idle> {
+        size_t count = 0;
+        while (count < idle.size() && stats.idle_bytes > limit) {
+            stats.idle_bytes -= bytes_of(idle[count].key);
+            count++;
+        }
+        std::vector<Idle> evicted;
+        evicted.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            evicted.push_back(std::move(idle[i]));
+        }
+        idle.erase(idle.begin(),
+                   idle.begin() + static_cast<ptrdiff_t>(count));
+        stats.idle_count -= count;
+        stats.evictions += count;
+        return evicted;
+    }
+
+    std::mutex mutex;
+    size_t budget;
+    size_t staging_depth;
+    std::vector<Idle> idle;  // oldest first
+    TexturePoolStats stats{};
+};
+};  // namespace detail
+
+// Recycles textures, with their staging buffers, between streams of the same
+// format and size, so a stream starting up skips glGenTextures(),
+// glTexImage2D() and the pixel unpack buffer allocations. Released textures
+// stay idle in the pool while they fit in `budget` bytes; past that, the
+// least recently released go first.
+//
+// Textures come back to the pool when their last shared_ptr goes away, so
+// drop it with a context of the share group current, as for any Texture.
+// A recycled texture still holds the previous stream's last frame. The pool
+// may be destroyed before the textures it handed out; those are then simply
+// deleted on release.
+struct TexturePool {
+    explicit TexturePool(size_t budget,
+                         size_t staging_depth = PixelUnpackRing::default_depth)
+        : state_(std::make_shared<detail::TexturePoolState>(budget,
+                                                            staging_depth)) {
+    }
+
+    template <int format>
+    auto acquire(GLsizei width, GLsizei height)
+        -> std::shared_ptr<Texture<format>> {
+        detail::TexturePoolState::Key key{format, width, height};
+        auto recycled = state_->take(key);
+        auto* texture =
+            recycled ? static_cast<Texture<format>*>(recycled.release())
+                     : new Texture<format>(width, height,
+                                           state_->staging_depth);
+        // Only now, so a texture that failed to construct is not counted.
+        state_->count_live(key);
+        std::weak_ptr<detail::TexturePoolState> pool = state_;
+        return {texture, [pool, key](Texture<format>* released) {
+                    detail::TexturePoolState::Owned owned{
+                        released, [](void* pointer) {
+                            delete static_cast<Texture<format>*>(pointer);
+                        }};
+                    if (auto state = pool.lock()) {
+                        state->give_back(key, std::move(owned));
+                    }
+                }};
+    }
+
+    auto set_budget(size_t budget) -> void {
+        std::vector<detail::TexturePoolState::Idle> evicted;
+        std::scoped_lock lock{state_->mutex};
+        state_->budget = budget;
+        evicted        = state_->evict(budget);
+    }
+
+    // Frees idle textures until at most `bytes` remain, e.g. 0 when the
+    // device reports memory pressure. Does not change the budget.
+    auto trim(size_t bytes = 0) -> void {
+        std::vector<detail::TexturePoolState::Idle> evicted;
+        std::scoped_lock lock{state_->mutex};
+        evicted = state_->evict(bytes);
+    }
+
+    auto get_stats() const -> TexturePoolStats {
+        std::scoped_lock lock{state_->mutex};
+        return state_->stats;
+    }
+
+private:
+    std::shared_ptr<detail::TexturePoolState> state_;
+};
+
+};  // namespace renderer
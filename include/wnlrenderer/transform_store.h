@@ -0,0 +1,109 @@
+#pragma once
+
+#include <wnlrenderer/renderer.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+// Positions, scales and transforms of many sprites kept in separate arrays,
+// with one dirty bit per sprite. update() walks the bitset a word at a time,
+// skipping 64 clean sprites per test, and rebuilds only what changed with
+// compose_2d(), which writes the matrix without any matrix products.
+//
+// Pair it with BatchRenderer::submit(shader, renderable, transform) so the
+// renderables only supply meshes and textures.
+struct TransformStore {
+    using Index = uint32_t;
+
+    auto add(glm::vec3 const& position, glm::vec2 const& scale) -> Index {
+        auto index = static_cast<Index>(positions_.size());
+        positions_.push_back(position);
+        scales_.push_back(scale);
+        transforms_.push_back(compose_2d(position, scale));
+        if (index % bits == 0) {
+            dirty_.push_back(0);
+        }
+        return index;
+    }
+
+    auto set_position(Index index, glm::vec3 const& position) -> void {
+        if (positions_[index] != position) {
+            positions_[index] = position;
+            mark(index);
+        }
+    }
+
+    auto set_scale(Index index, glm::vec2 const& scale) -> void {
+        if (scales_[index] != scale) {
+            scales_[index] = scale;
+            mark(index);
+        }
+    }
+
+    // Rebuilds the transforms of sprites changed since the last call and
+    // returns how many there were.
+    auto update() -> size_t {
+        size_t updated = 0;
+        for (size_t word = 0; word < dirty_.size(); word++) {
+            auto mask = std::exchange(dirty_[word], 0);
+            updated += static_cast<size_t>(std::popcount(mask));
+            while (mask != 0) {
+                auto index = (word * bits) +
+                             static_cast<size_t>(std::countr_zero(mask));
+                transforms_[index] =
+                    compose_2d(positions_[index], scales_[index]);
+                mask &= mask - 1;
+            }
+        }
+        return updated;
+    }
+
+    auto get_position(Index index) const -> glm::vec3 const& {
+        return positions_[index];
+    }
+
+    auto get_scale(Index index) const -> glm::vec2 const& {
+        return scales_[index];
+    }
+
+    // As of the last update().
+    auto get_transform(Index index) const -> glm::mat4 const& {
+        return transforms_[index];
+    }
+
+    auto get_transforms() const -> std::span<glm::mat4 const> {
+        return transforms_;
+    }
+
+    auto size() const noexcept -> size_t {
+        return positions_.size();
+    }
+
+    auto clear() -> void {
+        positions_.clear();
+        scales_.clear();
+        transforms_.clear();
+        dirty_.clear();
+    }
+
+private:
+    static constexpr size_t bits = 64;
+
+    auto mark(Index index) -> void {
+        dirty_[index / bits] |= uint64_t{1} << (index % bits);
+    }
+
+    std::vector<glm::vec3> positions_;
+    std::vector<glm::vec2> scales_;
+    std::vector<glm::mat4> transforms_;
+    std::vector<uint64_t> dirty_;
+};
+
+};  // namespace renderer
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <glad/gles2.h>
+#include <wnlrenderer/gl_state.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace renderer {
+
+enum class UploadStatus : uint8_t {
+    pending,
+    complete,
+    failed,     // the job threw
+    cancelled,  // the worker shut down before running the job
+};
+
+// Completion of one UploadWorker job. The fence is created on the upload
+// context once the job's commands are flushed; wait() makes the calling
+// context's GPU queue wait on it, without blocking the CPU once it exists,
+// and makes that context's next binds reach GL so they pick up what the job
+// wrote. Copies share the job, and every context that samples what it wrote
+// waits on it, as often as it likes.
+struct UploadFence {
+    auto get_status() const -> UploadStatus {
+        return state_->status.load(std::memory_order_acquire);
+    }
+
+    auto ready() const -> bool {
+        return get_status() != UploadStatus::pending;
+    }
+
+    // Call on the context that samples what the job wrote, before sampling.
+    // Rethrows what the job threw; false if it never ran.
+    auto wait() const -> bool {
+        state_->status.wait(UploadStatus::pending, std::memory_order_acquire);
+        switch (get_status()) {
+            case UploadStatus::complete:
+                glWaitSync(state_->fence, 0, GL_TIMEOUT_IGNORED);
+                gl_state().forget_shared();
+                return true;
+            case UploadStatus::failed:
+                std::rethrow_exception(state_->error);
+            default:
+                return false;
+        }
+    }
+
+private:
+    friend struct UploadWorker;
+
+    // The last copy of a fence has to go with a context of the share group
+    // current, for the sync object to be deleted.
+    struct State {
+        State()                        = default;
+        State(State const&)            = delete;
+        State& operator=(State const&) = delete;
+
+        ~State() {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+            }
+        }
+
+        // Publishes `fence` and `error` along with the result.
+        auto finish(UploadStatus result) -> void {
+            status.store(result, std::memory_order_release);
+            status.notify_all();
+        }
+
+        std::atomic<UploadStatus> status{UploadStatus::pending};
+        GLsync fence{};
+        std::exception_ptr error;
+    };
+
+    UploadFence() : state_(std::make_shared<State>()) {
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+// Runs GL jobs, typically Texture::copy_data or begin_upload/commit, on a
+// dedicated thread that owns a context sharing objects with the render
+// context, so upload time stays off the render thread.
+//
+// Jobs must not write a texture the render thread is sampling; double buffer
+// and switch to the new texture once its UploadFence has been waited on.
+struct UploadWorker {
+    // `acquire_context` is invoked on the worker thread and must return a
+    // guard that keeps a shared context current for as long as it lives.
+    template <typename AcquireContext>
+    explicit UploadWorker(AcquireContext acquire_context)
+        : thread_([this, acquire = std::move(acquire_context)](
+                      std::stop_token const& stop_token) {
+            [[maybe_unused]] auto context = acquire();
+            gl_state().reset();
+            run(stop_token);
+        }) {
+    }
+
+    UploadWorker(UploadWorker const&)            = delete;
+    UploadWorker& operator=(UploadWorker const&) = delete;
+    UploadWorker(UploadWorker&&)                 = delete;
+    UploadWorker& operator=(UploadWorker&&)      = delete;
+
+    ~UploadWorker() {
+        thread_.request_stop();
+        thread_.join();
+        // Whatever is still queued never runs; release its waiters.
+        for (auto& job : jobs_) {
+            job.state->finish(UploadStatus::cancelled);
+        }
+    }
+
+    auto submit(std::function<void()> job) -> UploadFence {
+        UploadFence fence;
+        {
+            std::scoped_lock lock{mutex_};
+            jobs_.push_back({std::move(job), fence.state_});
+        }
+        pending_.notify_one();
+        return fence;
+    }
+
+private:
+    struct Job {
+        std::function<void()> work;
+        std::shared_ptr<UploadFence::State> state;
+    };
+
+    auto run(std::stop_token const& stop_token) -> void {
+        while (!stop_token.stop_requested()) {
+            Job job;
+            {
+                std::unique_lock lock{mutex_};
+                if (!pending_.wait(lock, stop_token,
+                                   [this] { return !jobs_.empty(); })) {
+                    return;
+                }
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            auto result = UploadStatus::complete;
+            try {
+                job.work();
+                job.state->fence =
+                    glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                // The fence has to reach the GPU before another context waits.
+                glFlush();
+            } catch (...) {
+                job.state->error = std::current_exception();
+                result           = UploadStatus::failed;
+            }
+            job.state->finish(result);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable_any pending_;
+    std::deque<Job> jobs_;
+    std::jthread thread_;  // Last, so it stops before the queue goes away.
+};
+
+};  // namespace renderer
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <wnlrenderer/shader_variants.h>
+
 const char* fragment_shader = R"(
 precision mediump float;
 
@@ -13,40 +15,66 @@ void main()
 }
 )";
 
-const char* yuv_fragment_shader = R"(
+// BT.601 full range, from separate Y, U and V planes.
+const char* yuv_fragment_shader =
+    renderer::YuvVariant<renderer::YuvLayout::I420>::fragment_shader;
+
+// Semi-planar NV12: full resolution Y plane plus one half resolution RG plane
+// holding interleaved U (r) and V (g), so chroma costs a single fetch.
+const char* nv12_fragment_shader =
+    renderer::YuvVariant<renderer::YuvLayout::NV12>::fragment_shader;
+
+// NV21 is NV12 with the chroma pair swapped: V in r, U in g.
+const char* nv21_fragment_shader =
+    renderer::YuvVariant<renderer::YuvLayout::NV21>::fragment_shader;
+
+// Pairs with array_vertex_shader, or array_uniform_vertex_shader outside the
+// batch, to sample one layer of a TextureArray.
+const char* array_fragment_shader = R"(#version 300 es
 precision mediump float;
+precision mediump sampler2DArray;
 
-// Samplers for the three separate Y, U, and V texture planes
-uniform sampler2D u_texture_y;
-uniform sampler2D u_texture_u;
-uniform sampler2D u_texture_v;
+uniform sampler2DArray u_texture;
+in vec3 v_texCoord;
 
-varying vec2 v_texCoord;
+out vec4 fragColor;
+
+void main()
+{
+    vec3 flipped_uv = vec3(v_texCoord.x, 1.0 - v_texCoord.y, v_texCoord.z);
+    fragColor       = texture(u_texture, flipped_uv);
+}
+)";
+
+// fragment_shader for #version 300 es vertex shaders such as
+// block_vertex_shader.
+const char* texture_fragment_shader = R"(#version 300 es
+precision mediump float;
+
+uniform sampler2D u_texture;
+in vec2 v_texCoord;
+
+out vec4 fragColor;
 
 void main()
 {
-    // Flip the UV coordinates vertically to match OpenGL's texture coordinate system
     vec2 flipped_uv = vec2(v_texCoord.x, 1.0 - v_texCoord.y);
+    fragColor       = texture(u_texture, flipped_uv);
+}
+)";
+
+// Used with renderer::ExternalTexture in ExternalSampling::External mode; the
+// driver converts the imported YUV buffer to RGB while sampling.
+const char* external_fragment_shader = R"(
+#extension GL_OES_EGL_image_external : require
+precision mediump float;
 
-    // Sample the luma (brightness) and chroma (color) values from their respective textures.
-    // The same texture coordinates are used for all three; the GPU handles scaling
-    // correctly if the U and V planes are a lower resolution than the Y plane.
-    float y = texture2D(u_texture_y, flipped_uv).r;
-    float u = texture2D(u_texture_u, flipped_uv).r;
-    float v = texture2D(u_texture_v, flipped_uv).r;
-
-    // The U and V values are centered around 0.5, so they must be shifted
-    // back to the [-0.5, 0.5] range for the conversion math.
-    u = u - 0.5;
-    v = v - 0.5;
-
-    // Standard YUV to RGB conversion formula
-    float r = y + (1.402 * v);
-    float g = y - (0.344136 * u) - (0.714136 * v);
-    float b = y + (1.772 * u);
-
-    // Set the final color, ensuring the values are clamped to the [0.0, 1.0] range,
-    // with a full alpha channel.
-    gl_FragColor = vec4(clamp(vec3(r, g, b), 0.0, 1.0), 1.0);
+uniform samplerExternalOES u_texture;
+varying vec2 v_texCoord;
+
+void main()
+{
+    vec2 flipped_uv = vec2(v_texCoord.x, 1.0 - v_texCoord.y);
+    gl_FragColor    = texture2D(u_texture, flipped_uv);
 }
 )";
@@ -2,14 +2,29 @@
 #include <GLFW/glfw3.h>
 #include <fmt/format.h>
 #include <glad/gles2.h>
+#include <wnlrenderer/damage.h>
+#include <wnlrenderer/frame_queue.h>
+#include <wnlrenderer/profiler.h>
 #include <wnlrenderer/renderer.h>
+#include <wnlrenderer/upload_worker.h>
 #include <window.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <span>
+#include <string>
+#include <system_error>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "frag.h"
@@ -34,68 +49,365 @@ constexpr std::array<uint32_t, 6> indices{
     2, 1, 3   // Second Triangle
 };
 
-int window_width           = 800;
-int window_height          = 600;
-glm::mat4 projectionMatrix = glm::ortho(0.0F,
-                                        static_cast<float>(window_width),
-                                        static_cast<float>(window_height),
-                                        0.0F);
+constexpr int window_count = 2;
+
+struct DecodedFrame {
+    renderer::PresentClock::time_point pts;
+    uint32_t color;
+};
+
+auto fill(renderer::Texture<GL_RGBA>& texture, uint32_t color) -> void {
+    auto frame = texture.begin_upload();
+    for (auto row = 0; row < 600; row++) {
+        auto* pixels = reinterpret_cast<uint32_t*>(  // NOLINT
+            frame.data() + static_cast<ptrdiff_t>(row * frame.pitch()));
+        std::fill_n(pixels, 800, color);
+    }
+    texture.commit(frame);
+}
+
+// Objects used by every window's context, created once with the primary
+// window's context current.
+struct SharedResources {
+    explicit SharedResources(renderer::ProgramBinaryCache const& cache)
+        : program{std::string{block_vertex_shader},
+                  std::string{texture_fragment_shader}, &cache} {
+    }
+
+    renderer::ShaderProgram program;
+    std::shared_ptr<renderer::Mesh> quad = std::make_shared<renderer::Mesh>(
+        std::span{vertices}, std::span{indices});
+    std::shared_ptr<renderer::Texture<GL_RGBA>> still =
+        std::make_shared<renderer::Texture<GL_RGBA>>(800, 600);
+};
+
+// Decoded frames uploaded into the back texture on the upload thread and
+// shown in every window. Each render thread waits on the upload's fence on
+// its own context before drawing the new front texture, and the old one is
+// only rewritten once every window has switched.
+struct VideoStream {
+    VideoStream(renderer::FrameQueue<DecodedFrame>& frames,
+                renderer::UploadWorker& uploader,
+                size_t viewers)
+        : frames(frames), uploader(uploader), seen(viewers, 0) {
+        fill(*textures[front], 0xFF000000U);
+    }
+
+    renderer::FrameQueue<DecodedFrame>& frames;
+    renderer::UploadWorker& uploader;
+    std::array<std::shared_ptr<renderer::Texture<GL_RGBA>>, 2> textures{
+        std::make_shared<renderer::Texture<GL_RGBA>>(800, 600),
+        std::make_shared<renderer::Texture<GL_RGBA>>(800, 600)};
+
+    std::mutex mutex;
+    std::optional<renderer::UploadFence> pending;
+    std::optional<renderer::UploadFence> shown;  // wrote textures[front]
+    size_t front    = 0;
+    uint64_t serial = 0;         // bumped whenever front changes
+    std::vector<uint64_t> seen;  // serial each window last waited on
+
+    // Call on the viewer's context before drawing; returns the texture to
+    // draw.
+    auto update(size_t viewer) -> size_t {
+        std::optional<renderer::UploadFence> fence;
+        size_t current = 0;
+        {
+            std::scoped_lock lock{mutex};
+            if (pending && pending->ready()) {
+                shown = std::exchange(pending, std::nullopt);
+                front ^= 1U;
+                serial++;
+            }
+            current = front;
+            if (seen[viewer] != serial) {
+                seen[viewer] = serial;
+                fence        = shown;
+            }
+        }
+        if (fence) {
+            fence->wait();
+        }
+        return current;
+    }
+
+    // Queues the next frame's upload into the back texture. Only one thread
+    // may call it, as the FrameQueue has a single consumer.
+    auto feed(renderer::FramePacer<DecodedFrame>& pacer) -> void {
+        std::scoped_lock lock{mutex};
+        if (pending || std::ranges::any_of(seen, [this](uint64_t viewed) {
+                return viewed != serial;
+            })) {
+            return;
+        }
+        if (auto decoded = pacer.select(frames)) {
+            auto& back = *textures[front ^ 1U];
+            pending    = uploader.submit(
+                [&back, color = decoded->color] { fill(back, color); });
+        }
+    }
+
+    // Once the render threads are gone, on a shared context: the job may
+    // still be writing a texture that is about to be released.
+    auto finish() -> void {
+        if (pending) {
+            pending->wait();
+        }
+        pending.reset();
+        shown.reset();
+    }
+};
+
+// Draws with the fragment shader in `path`, rebuilt in the background
+// whenever the file changes; the previous program stays in use until the new
+// one is ready, or if it fails to build.
+struct ShaderReloader {
+    explicit ShaderReloader(std::filesystem::path path)
+        : path_(std::move(path))
+        , slot_(renderer::ShaderProgram{std::string{block_vertex_shader},
+                                        std::string{texture_fragment_shader}}) {
+    }
+
+    auto current() -> renderer::ShaderProgram const& {
+        poll();
+        try {
+            return slot_.current();
+        } catch (std::exception const& error) {
+            fmt::println(stderr, "{}: {}", path_.string(), error.what());
+            return slot_.current();
+        }
+    }
+
+private:
+    auto poll() -> void {
+        using namespace std::chrono_literals;
+        auto now = std::chrono::steady_clock::now();
+        if (now < next_poll_) {
+            return;
+        }
+        next_poll_ = now + 500ms;
+
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(path_, error);
+        if (error || modified == modified_) {
+            return;
+        }
+        modified_ = modified;
+        std::ifstream file{path_};
+        std::string source{std::istreambuf_iterator<char>{file},
+                           std::istreambuf_iterator<char>{}};
+        slot_.replace(renderer::ShaderProgram::deferred(
+            std::string{block_vertex_shader}, std::move(source)));
+    }
+
+    std::filesystem::path path_;
+    renderer::ProgramSlot slot_;
+    std::filesystem::file_time_type modified_{};
+    std::chrono::steady_clock::time_point next_poll_{};
+};
+
+auto render(window::Window& window,
+            SharedResources const& shared,
+            VideoStream& video,
+            size_t viewer,
+            std::optional<std::filesystem::path> const& trace,
+            std::optional<std::filesystem::path> const& fragment_path,
+            std::stop_token const& stop_token) -> void {
+    auto context = window.get_context();
+    glfwSwapInterval(1);
+
+    // Programs are shared, but a slot swaps them, so each window keeps its
+    // own.
+    std::optional<ShaderReloader> reloader;
+    if (fragment_path) {
+        reloader.emplace(*fragment_path);
+    }
+
+    renderer::Profiler profiler;
+    profiler.attach();
+
+    // Each context needs its own VAO and uniform buffers.
+    auto quad = shared.quad->share();
+    renderer::UniformBuffer<renderer::FrameUniforms> frame_uniforms{
+        renderer::uniform_block::frame};
+    renderer::UniformRing<renderer::DrawUniforms> draw_uniforms{
+        renderer::uniform_block::draw, 2};
+
+    renderer::Renderable still{quad, shared.still};
+    still.set_scale({100.0F, 100.0F});
+    still.set_position(renderer::PositionTopLeft, {10.0F, 10.0F, 0.0F});
+
+    std::vector<renderer::Renderable<GL_RGBA>> streams;
+    for (auto const& texture : video.textures) {
+        streams.emplace_back(quad, texture);
+        streams.back().set_scale({200.0F, 100.0F});
+    }
+
+    frame_uniforms.bind();
+    window::Viewport viewport{};
+    auto viewport_version = ~uint64_t{0};
+
+    renderer::FramePacer<DecodedFrame> pacer;
+    renderer::DamageTracker damage_tracker;
+    glEnable(GL_SCISSOR_TEST);
+
+    glClearColor(0xFF / 255.0F, 0x0 / 255.0F, 0xFF / 255.0F, 1.0F);
+    while (!stop_token.stop_requested()) {
+        profiler.begin_frame();
+        // Size-dependent state is only rebuilt on the frame after a resize.
+        if (auto version = window.get_viewport_version();
+            version != viewport_version) {
+            viewport_version = version;
+            viewport         = window.get_viewport();
+            glViewport(0, 0, viewport.size.width, viewport.size.height);
+            frame_uniforms.set_data({viewport.projection});
+        }
+
+        damage_tracker.track(still);
+        std::vector<renderer::DrawUniforms> draws{{still.get_transform()}};
+        auto& stream = streams[video.update(viewer)];
+        if (viewer == 0) {  // paces the stream for every window
+            video.feed(pacer);
+        }
+        stream.set_position(
+            renderer::PositionCenter,
+            {static_cast<float>(viewport.size.width) / 2.0F,
+             static_cast<float>(viewport.size.height) / 2.0F, 0.0F});
+        damage_tracker.track(stream);
+        draws.push_back({stream.get_transform()});
+
+        // GLFW does not report the buffer age, so any damage repaints the
+        // whole window; unchanged frames are not drawn or swapped at all.
+        auto damage = damage_tracker.end_frame(viewport.size.width,
+                                               viewport.size.height);
+        if (damage.empty()) {
+            profiler.end_frame();
+            std::this_thread::sleep_until(pacer.next_vsync());
+            continue;
+        }
+        {
+            renderer::GpuZone gpu_zone{"draw"};
+            renderer::scissor(renderer::bounds_of(damage),
+                              viewport.size.height);
+            draw_uniforms.upload(draws);
+
+            glClear(GL_COLOR_BUFFER_BIT);
+            auto const& program =
+                reloader ? reloader->current() : shared.program;
+            program.use();
+
+            still.draw(draw_uniforms, 0);
+            stream.draw(draw_uniforms, 1);
+            draw_uniforms.fence();
+        }
+
+        window.swap_buffers();
+        pacer.on_present();
+        profiler.end_frame();
+    }
+
+    if (trace) {
+        std::ofstream file{*trace};
+        profiler.write_chrome_trace(file);
+    }
+}
 
 int main() {
     glfwSetErrorCallback(error_callback);
     window::GLFWContext _{};
 
-    window::Window window{
-        {.width = window_width, .height = window_height},
-        "Window 1"
-    };
+    std::vector<std::unique_ptr<window::Window>> windows;
+    for (int i = 0; i < window_count; i++) {
+        windows.push_back(std::make_unique<window::Window>(
+            window::WindowSize{.width = 800, .height = 600},
+            fmt::format("Window {}", i + 1),
+            windows.empty() ? nullptr : windows.front().get()));
+    }
+    auto& primary = *windows.front();
 
+    std::unique_ptr<SharedResources> shared;
     {
-        auto context = window.get_context();
+        auto context = primary.get_context();
         gladLoadGLES2(glfwGetProcAddress);
+        renderer::enable_parallel_shader_compile(glfwGetProcAddress);
+        renderer::load_timer_query(glfwGetProcAddress);
+        renderer::ProgramBinaryCache cache{
+            std::filesystem::temp_directory_path() / "wnlrenderer"};
+        shared = std::make_unique<SharedResources>(cache);
+        fill(*shared->still, 0U | (255U << 24) | (128U << 16) | (255U << 8) |
+                                 (128U << 0));
     }
 
-    std::jthread t{[&](const std::stop_token& stop_token) {
-        auto context = window.get_context();
-        renderer::ShaderProgram shaderProgram{std::string{vertex_shader},
-                                              std::string{fragment_shader}};
-        glfwSwapInterval(1);
-
-        auto quad = std::make_shared<renderer::Mesh>(std::span{vertices},
-                                                     std::span{indices});
+    auto upload_window = window::Window::create_shared_context(primary);
+    renderer::UploadWorker uploader{
+        [&] { return upload_window->get_context(); }};
 
-        std::vector<uint32_t> textureData;
-        textureData.resize(static_cast<size_t>(800 * 600));
-        std::ranges::fill(textureData, 0U | (255U << 24) | (128U << 16) |
-                                           (255U << 8) | (128U << 0));
-        auto tex = std::make_shared<renderer::Texture<GL_RGBA>>(800, 600);
-        tex->copy_data(std::as_bytes(std::span{textureData}), 800);
+    renderer::FrameQueue<DecodedFrame> frames;
 
-        renderer::Renderable square{quad, tex};
-        auto w = 200.0F;
-        auto h = 100.0F;
-        square.set_scale({w, h});
+    // Stands in for a decoder: a new solid colour every 1/30 s, queued ahead
+    // of its presentation time.
+    std::jthread decoder{[&](const std::stop_token& stop_token) {
+        using namespace std::chrono_literals;
+        auto pts = renderer::PresentClock::now();
+        for (uint32_t i = 0; !stop_token.stop_requested();) {
+            if (frames.try_push({pts, 0xFF000000U | (i * 0x00030507U)})) {
+                pts += 33'333us;
+                i++;
+            } else {
+                std::this_thread::sleep_for(5ms);
+            }
+        }
+    }};
 
-        glClearColor(0xFF / 255.0F, 0x0 / 255.0F, 0xFF / 255.0F, 1.0F);
-        while (!stop_token.stop_requested()) {
-            square.set_position(
-                renderer::PositionCenter,
-                {static_cast<float>(window_width) / 2.0F,
-                 static_cast<float>(window_height) / 2.0F, 0.0F});
+    {
+        std::unique_ptr<VideoStream> video;
+        {
+            auto context = primary.get_context();
+            video = std::make_unique<VideoStream>(frames, uploader,
+                                                  windows.size());
+        }
 
-            glViewport(0, 0, window_width, window_height);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderProgram.use();
-            shaderProgram.set_mat4("u_Projection", projectionMatrix);
+        // WNLRENDERER_TRACE=<prefix> writes <prefix>-<window>.json on exit.
+        auto const* trace_prefix = std::getenv("WNLRENDERER_TRACE");
+        // WNLRENDERER_FRAGMENT=<file> draws with that fragment shader and
+        // reloads it on change.
+        std::optional<std::filesystem::path> fragment_path;
+        if (auto const* path = std::getenv("WNLRENDERER_FRAGMENT")) {
+            fragment_path = path;
+        }
+        std::vector<std::jthread> render_threads;
+        for (size_t i = 0; i < windows.size(); i++) {
+            auto& window = *windows[i];
+            std::optional<std::filesystem::path> trace;
+            if (trace_prefix != nullptr) {
+                trace = fmt::format("{}-{}.json", trace_prefix, i + 1);
+            }
+            render_threads.emplace_back(
+                [&window, &shared = *shared, &video = *video, i, trace,
+                 &fragment_path](std::stop_token const& stop_token) {
+                    render(window, shared, video, i, trace, fragment_path,
+                           stop_token);
+                });
+        }
 
-            square.draw(shaderProgram);
+        // should_close() is true while the window stays open.
+        auto all_open = [&] {
+            return std::ranges::all_of(windows, [](auto const& window) {
+                return window->should_close();
+            });
+        };
+        while (all_open()) {
+            glfwWaitEvents();
+        }
 
-            window.swap_buffers();
+        for (auto& thread : render_threads) {
+            thread.request_stop();
         }
-    }};
+        render_threads.clear();
 
-    while (window.should_close()) {
-        glfwWaitEvents();
+        auto context = primary.get_context();
+        video->finish();
+        video.reset();
+        shared.reset();
     }
 
     return 0;
@@ -15,3 +15,81 @@ void main()
    v_texCoord = a_texCoord;
 }
 )";
+
+// Used with renderer::BatchRenderer: the transform arrives per instance.
+const char* instanced_vertex_shader = R"(
+uniform mat4 u_Projection;
+
+attribute vec4 a_position;
+attribute vec2 a_texCoord;
+attribute mat4 a_transform;
+
+varying vec2 v_texCoord;
+
+void main()
+{
+   gl_Position = u_Projection * a_transform * a_position;
+   v_texCoord = a_texCoord;
+}
+)";
+
+// Used with renderer::BatchRenderer and renderer::TextureArray; the array
+// layer travels with the per-instance transform.
+const char* array_vertex_shader = R"(#version 300 es
+uniform mat4 u_Projection;
+
+in vec4 a_position;
+in vec2 a_texCoord;
+in mat4 a_transform;
+in float a_layer;
+
+out vec3 v_texCoord;
+
+void main()
+{
+   gl_Position = u_Projection * a_transform * a_position;
+   v_texCoord = vec3(a_texCoord, a_layer);
+}
+)";
+
+// Used with renderer::TextureArray outside the batch: Renderable::draw,
+// ResourceRegistry::draw and CommandBuffer::replay set u_Transform, and the
+// layer as the constant value of `a_layer`.
+const char* array_uniform_vertex_shader = R"(#version 300 es
+uniform mat4 u_Transform;
+uniform mat4 u_Projection;
+
+in vec4 a_position;
+in vec2 a_texCoord;
+in float a_layer;
+
+out vec3 v_texCoord;
+
+void main()
+{
+   gl_Position = u_Projection * u_Transform * a_position;
+   v_texCoord = vec3(a_texCoord, a_layer);
+}
+)";
+
+// Reads the projection and transform from the FrameUniforms and DrawUniforms
+// blocks, so one program can serve several windows rendering concurrently.
+const char* block_vertex_shader = R"(#version 300 es
+layout(std140) uniform FrameUniforms {
+    mat4 u_Projection;
+};
+layout(std140) uniform DrawUniforms {
+    mat4 u_Transform;
+};
+
+in vec4 a_position;
+in vec2 a_texCoord;
+
+out vec2 v_texCoord;
+
+void main()
+{
+   gl_Position = u_Projection * u_Transform * a_position;
+   v_texCoord = a_texCoord;
+}
+)";
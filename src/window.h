@@ -1,13 +1,18 @@
 #pragma once
 
 #include <GLFW/glfw3.h>
+#include <wnlrenderer/gl_state.h>
+#include <wnlrenderer/profiler.h>
+#include <wnlrenderer/seqlock.h>
 
 #include <atomic>
+#include <cstdint>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <utility>
 
 namespace window {
@@ -17,24 +22,39 @@ struct WindowSize {
     int height;
 };
 
+struct Viewport {
+    WindowSize size;
+    glm::mat4 projection;
+};
+
+inline auto make_viewport(int width, int height) -> Viewport {
+    return {
+        {width, height},
+        glm::ortho(0.0F, static_cast<float>(width), static_cast<float>(height),
+                   0.0F)
+    };
+}
+
 // Precondition: Can only exist on the main thread
 // Precondition: GLFWContext must be created before and be alive during
 class Window {
 public:
-    explicit Window(WindowSize size, std::string window_title)
-        : window_width_(size.width)
-        , window_height_(size.height)
-        , window_title_(std::move(window_title))
-        , projection_matrix_(glm::ortho(0.0F,
-                                        static_cast<float>(window_width_),
-                                        static_cast<float>(window_height_),
-                                        0.0F)) {
+    // With `share`, the new context shares textures, buffers and programs
+    // with that window's context.
+    explicit Window(WindowSize size,
+                    std::string window_title,
+                    Window const* share = nullptr)
+        : window_title_(std::move(window_title))
+        , viewport_(make_viewport(size.width, size.height)) {
         glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
 
-        GLFWwindow* window = glfwCreateWindow(window_width_, window_height_,
-                                              "Window 1", nullptr, nullptr);
+        GLFWwindow* window = glfwCreateWindow(size.width, size.height,
+                                              window_title_.c_str(), nullptr,
+                                              share != nullptr
+                                                  ? share->window_.get()
+                                                  : nullptr);
         if (window == nullptr) {
             char const* error = nullptr;
             glfwGetError(&error);
@@ -46,7 +66,29 @@ public:
         glfwSetKeyCallback(window_.get(), key_callback);
     }
 
+    // Invisible window whose only use is a context sharing objects with
+    // `share`, e.g. for a renderer::UploadWorker.
+    static auto create_shared_context(Window const& share)
+        -> std::unique_ptr<Window> {
+        // Later windows are visible again even if creation throws.
+        struct HiddenWindows {
+            HiddenWindows() {
+                glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            }
+
+            ~HiddenWindows() {
+                glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+            }
+
+            HiddenWindows(HiddenWindows const&)            = delete;
+            HiddenWindows& operator=(HiddenWindows const&) = delete;
+        } const hidden;
+        return std::make_unique<Window>(WindowSize{1, 1}, "Upload context",
+                                        &share);
+    }
+
     auto swap_buffers() -> void {
+        renderer::CpuZone zone{"swap_buffers"};
         glfwSwapBuffers(window_.get());
     }
 
@@ -54,6 +96,17 @@ public:
         return glfwWindowShouldClose(window_.get()) != GLFW_TRUE;
     }
 
+    // Safe from any thread. Render threads poll get_viewport_version() each
+    // frame and only reload the viewport and rebuild what depends on its
+    // size when it changes.
+    auto get_viewport() const -> Viewport {
+        return viewport_.load();
+    }
+
+    auto get_viewport_version() const -> uint64_t {
+        return viewport_.version();
+    }
+
     struct OpenGLContext {
         ~OpenGLContext() {
             glfwMakeContextCurrent(nullptr);
@@ -81,6 +134,7 @@ public:
         }
 
         glfwMakeContextCurrent(window_.get());
+        renderer::gl_state().reset();
         return {*this};
     }
 
@@ -89,10 +143,7 @@ private:
                                           int width,
                                           int height) {
         auto* w = static_cast<Window*>(glfwGetWindowUserPointer(window));
-        w->window_width_      = width;
-        w->window_height_     = height;
-        w->projection_matrix_ = glm::ortho(0.0F, static_cast<float>(width),
-                                           static_cast<float>(height), 0.0F);
+        w->viewport_.store(make_viewport(width, height));
     }
 
     static void key_callback(
@@ -103,10 +154,8 @@ private:
     }
 
 private:
-    int window_width_;
-    int window_height_;
     std::string window_title_;
-    glm::mat4 projection_matrix_;
+    renderer::SeqLock<Viewport> viewport_;  // Written by the main thread only.
     std::unique_ptr<GLFWwindow, decltype(&glfwDestroyWindow)> window_{
         nullptr, &glfwDestroyWindow};
     std::atomic<bool> context_out_ = false;
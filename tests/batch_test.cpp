@@ -0,0 +1,132 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/batch.h>
+
+#include <memory>
+#include <span>
+
+using namespace renderer;
+
+namespace {
+struct Scene {
+    auto make(glm::vec3 top_left, glm::vec2 size) -> Renderable<GL_RGB> {
+        Renderable<GL_RGB> renderable{quad, texture};
+        renderable.set_scale(size);
+        renderable.set_position(PositionTopLeft, top_left);
+        return renderable;
+    }
+
+    fake_gl::Context context;
+    std::shared_ptr<Mesh> quad =
+        std::make_shared<Mesh>(std::span{vertices}, std::span{indices});
+    std::shared_ptr<Texture<GL_RGB>> texture =
+        std::make_shared<Texture<GL_RGB>>(4, 4, 0);
+    ShaderProgram program{"void main() {}", "void main() {}"};
+    glm::mat4 projection = glm::ortho(0.0F, 1280.0F, 720.0F, 0.0F);
+    BatchRenderer batch;
+};
+};  // namespace
+
+TEST(cull_skips_off_screen_and_covered) {
+    Scene scene;
+    auto video   = scene.make({0.0F, 0.0F, 1.0F}, {1280.0F, 720.0F});
+    auto covered = scene.make({10.0F, 10.0F, 0.0F}, {100.0F, 100.0F});
+    auto off     = scene.make({2000.0F, 10.0F, 2.0F}, {100.0F, 100.0F});
+    auto above   = scene.make({10.0F, 10.0F, 2.0F}, {100.0F, 100.0F});
+    auto beside  = scene.make({500.0F, 500.0F, 1.0F}, {50.0F, 50.0F});
+    auto glass   = scene.make({0.0F, 0.0F, 3.0F}, {1280.0F, 720.0F});
+    glass.set_opaque(false);
+
+    for (auto* renderable : {&video, &covered, &off, &above, &beside, &glass}) {
+        scene.batch.submit(scene.program, *renderable);
+    }
+    scene.batch.cull(scene.projection);
+    CHECK(scene.batch.is_visible(video));
+    CHECK(!scene.batch.is_visible(covered));
+    CHECK(!scene.batch.is_visible(off));
+    CHECK(scene.batch.is_visible(above));
+    CHECK(scene.batch.is_visible(beside));  // same z does not occlude
+    CHECK(scene.batch.is_visible(glass));   // translucent covers nothing
+
+    scene.batch.flush(scene.projection);
+    CHECK(scene.batch.get_culled() == 2);
+}
+
+TEST(submissions_after_cull_are_culled_too) {
+    Scene scene;
+    auto cover  = scene.make({0.0F, 0.0F, 1.0F}, {1280.0F, 720.0F});
+    auto first  = scene.make({10.0F, 10.0F, 0.0F}, {100.0F, 100.0F});
+    auto second = scene.make({300.0F, 10.0F, 0.0F}, {100.0F, 100.0F});
+    auto top    = scene.make({300.0F, 10.0F, 2.0F}, {100.0F, 100.0F});
+
+    scene.batch.submit(scene.program, cover);
+    scene.batch.submit(scene.program, first);
+    scene.batch.cull(scene.projection);
+    scene.batch.submit(scene.program, second);
+    scene.batch.submit(scene.program, top);
+    scene.batch.flush();
+
+    CHECK(scene.batch.get_culled() == 2);
+    CHECK(scene.batch.get_draw_calls() == 2);
+}
+
+TEST(flush_without_cull_draws_everything) {
+    Scene scene;
+    auto cover   = scene.make({0.0F, 0.0F, 1.0F}, {1280.0F, 720.0F});
+    auto covered = scene.make({10.0F, 10.0F, 0.0F}, {100.0F, 100.0F});
+    scene.batch.submit(scene.program, cover);
+    scene.batch.submit(scene.program, covered);
+    scene.batch.flush();
+    CHECK(scene.batch.get_culled() == 0);
+    CHECK(scene.batch.get_draw_calls() == 2);
+
+    // The next frame starts over rather than reusing an earlier cull.
+    scene.batch.submit(scene.program, covered);
+    scene.batch.cull(scene.projection);
+    scene.batch.flush();
+    scene.batch.submit(scene.program, covered);
+    scene.batch.flush();
+    CHECK(scene.batch.get_culled() == 0);
+    CHECK(scene.batch.get_draw_calls() == 1);
+}
+
+TEST(shared_meshes_and_textures_batch) {
+    Scene scene;
+    auto left  = scene.make({0.0F, 0.0F, 0.0F}, {10.0F, 10.0F});
+    auto right = scene.make({20.0F, 0.0F, 0.0F}, {10.0F, 10.0F});
+    scene.batch.submit(scene.program, left);
+    scene.batch.submit(scene.program, right);
+    scene.batch.flush(scene.projection);
+    CHECK(scene.batch.get_draw_calls() == 1);
+}
+
+TEST(overlaps_at_one_z_keep_submission_order) {
+    Scene scene;
+    auto other = std::make_shared<Texture<GL_RGB>>(4, 4, 0);
+    auto first = scene.make({0.0F, 0.0F, 0.0F}, {10.0F, 10.0F});
+    Renderable<GL_RGB> middle{scene.quad, other};
+    middle.set_scale({10.0F, 10.0F});
+    middle.set_position(PositionTopLeft, {5.0F, 0.0F, 0.0F});
+    auto last = scene.make({10.0F, 0.0F, 0.0F}, {10.0F, 10.0F});
+
+    // `last` overlaps `middle`, drawn over `first`, so it cannot join it.
+    for (auto* renderable : {&first, &middle, &last}) {
+        scene.batch.submit(scene.program, *renderable);
+    }
+    scene.batch.flush(scene.projection);
+    CHECK(scene.batch.get_draw_calls() == 3);
+
+    // Moved clear of `middle`, it batches with `first` again; the edge it
+    // shares with `first` is no overlap.
+    last.set_position(PositionTopLeft, {-10.0F, 0.0F, 0.0F});
+    for (auto* renderable : {&first, &middle, &last}) {
+        scene.batch.submit(scene.program, *renderable);
+    }
+    scene.batch.flush(scene.projection);
+    CHECK(scene.batch.get_draw_calls() == 2);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,144 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/command_buffer.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <glm/ext/matrix_transform.hpp>
+#include <memory>
+#include <set>
+#include <span>
+#include <thread>
+#include <vector>
+
+using namespace renderer;
+
+namespace {
+// x of each u_Transform set, in order: the draws replay() issued.
+std::vector<float> transforms;
+
+auto GLAD_API_PTR set_matrix(GLint, GLsizei, GLboolean, GLfloat const* value)
+    -> void {
+    transforms.push_back(value[12]);
+}
+
+struct Scene {
+    Scene() {
+        glad_glUniformMatrix4fv = &set_matrix;
+        transforms.clear();
+    }
+
+    auto packet(float x) -> DrawPacket {
+        return {.program        = &program,
+                .mesh           = quad.get(),
+                .texture_target = GL_TEXTURE_2D,
+                .textures       = {},
+                .layer          = 0.0F,
+                .transform =
+                    glm::translate(glm::mat4{1.0F}, glm::vec3{x, 0.0F, 0.0F})};
+    }
+
+    fake_gl::Context context;
+    std::shared_ptr<Mesh> quad =
+        std::make_shared<Mesh>(std::span{vertices}, std::span{indices});
+    ShaderProgram program{"void main() {}", "void main() {}"};
+};
+};  // namespace
+
+TEST(arena_aligns_and_fills_up) {
+    FrameArena arena{64};
+    auto* byte = arena.allocate(1, 1);
+    auto* word = arena.allocate(8, 8);
+    CHECK(byte != nullptr);
+    CHECK(reinterpret_cast<uintptr_t>(word) % 8 == 0);  // NOLINT
+    CHECK(arena.get_used() == 16);
+    CHECK(arena.allocate(64, 1) == nullptr);
+    CHECK(arena.get_used() == 16);
+
+    arena.reset();
+    CHECK(arena.allocate(64, 1) != nullptr);
+}
+
+TEST(arena_hands_out_disjoint_blocks_concurrently) {
+    constexpr int threads  = 4;
+    constexpr int per_each = 256;
+    FrameArena arena{threads * per_each * sizeof(uint64_t)};
+    std::vector<std::vector<uint64_t*>> blocks(threads);
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([&arena, &mine = blocks[i]] {
+                for (int j = 0; j < per_each; j++) {
+                    mine.push_back(arena.create<uint64_t>(uint64_t{0}));
+                }
+            });
+        }
+    }
+    std::set<uint64_t*> distinct;
+    for (auto const& mine : blocks) {
+        distinct.insert(mine.begin(), mine.end());
+    }
+    CHECK(distinct.size() == threads * per_each);
+    CHECK(!distinct.contains(nullptr));
+    CHECK(arena.create<uint64_t>(uint64_t{0}) == nullptr);
+}
+
+TEST(sort_keys_order_layers_first) {
+    CHECK(make_sort_key(1, 0, 0) > make_sort_key(0, 0xFFFF, 0xFFFFFFFF));
+    CHECK(make_sort_key(0, 2, 0) > make_sort_key(0, 1, 0xFFFFFFFF));
+    CHECK(make_sort_key(0, 1, 2) > make_sort_key(0, 1, 1));
+}
+
+TEST(replay_sorts_by_key_then_recording_order) {
+    Scene scene;
+    CommandBuffer commands{8};
+    commands.record(2, scene.packet(1.0F));
+    commands.record(1, scene.packet(2.0F));
+    commands.record(2, scene.packet(3.0F));
+    commands.record(0, scene.packet(4.0F));
+    commands.replay();
+    CHECK((transforms == std::vector{4.0F, 2.0F, 1.0F, 3.0F}));
+
+    commands.reset();
+    CHECK(commands.size() == 0);
+    transforms.clear();
+    commands.record(0, scene.packet(5.0F));
+    commands.replay();
+    CHECK((transforms == std::vector{5.0F}));
+}
+
+TEST(recording_past_capacity_throws) {
+    Scene scene;
+    CommandBuffer commands{2};
+    commands.record(0, scene.packet(0.0F));
+    commands.record(0, scene.packet(0.0F));
+    CHECK_THROWS(commands.record(0, scene.packet(0.0F)));
+    CHECK(commands.size() == 2);
+}
+
+TEST(threads_record_concurrently) {
+    Scene scene;
+    constexpr int threads  = 4;
+    constexpr int per_each = 100;
+    CommandBuffer commands{threads * per_each};
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([&, i] {
+                for (int j = 0; j < per_each; j++) {
+                    commands.record(static_cast<uint64_t>(j),
+                                    scene.packet(static_cast<float>(i)));
+                }
+            });
+        }
+    }
+    CHECK(commands.size() == threads * per_each);
+    commands.replay();
+    CHECK(transforms.size() == threads * per_each);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,179 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/convert.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace renderer;
+using namespace renderer::detail::convert;
+
+namespace {
+// Deterministic noise, so a mismatch reproduces.
+auto noise(size_t size, uint32_t seed) -> std::vector<uint8_t> {
+    std::vector<uint8_t> bytes(size);
+    for (auto& byte : bytes) {
+        seed = seed * 1664525U + 1013904223U;
+        byte = static_cast<uint8_t>(seed >> 24);
+    }
+    return bytes;
+}
+
+auto vector_levels() -> std::vector<SimdLevel> {
+    std::vector<SimdLevel> levels;
+    for (auto level : {SimdLevel::sse2, SimdLevel::avx2, SimdLevel::neon}) {
+        if (is_supported(level)) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+// Planes a packed kernel writes for one row pair of `width` pixels.
+struct PackedOutput {
+    explicit PackedOutput(int width)
+        : y0(static_cast<size_t>(width))
+        , y1(static_cast<size_t>(width))
+        , u(static_cast<size_t>(width))
+        , v(static_cast<size_t>(width)) {
+    }
+
+    auto rows(std::vector<uint8_t> const& src, int width, bool planar)
+        -> RowPair {
+        return {.src = {src.data(), src.data() + 2 * width},
+                .y   = {y0.data(), y1.data()},
+                .u   = u.data(),
+                .v   = planar ? v.data() : nullptr};
+    }
+
+    auto operator==(PackedOutput const&) const -> bool = default;
+
+    std::vector<uint8_t> y0;
+    std::vector<uint8_t> y1;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+};
+
+auto convert_frame(SimdLevel level,
+                   unsigned threads,
+                   SourceFormat source,
+                   YuvLayout layout,
+                   std::vector<uint8_t> const& data,
+                   int width,
+                   int height) -> std::vector<std::byte> {
+    YuvTexture texture{layout, width, height};
+    ColorConverter converter{level, threads};
+    auto frame = texture.begin_upload();
+    converter.convert(source, std::as_bytes(std::span{data}), 0, texture,
+                      frame);
+    std::vector<std::byte> planes(frame.span().begin(), frame.span().end());
+    texture.commit(frame);
+    return planes;
+}
+};  // namespace
+
+// Widths that are no multiple of any vector width leave a scalar tail.
+TEST(packed_kernels_match_scalar) {
+    auto scalar = kernels_for(SimdLevel::scalar);
+    for (auto level : vector_levels()) {
+        auto kernels = kernels_for(level);
+        for (int width : {2, 6, 14, 18, 30, 34, 62, 66, 98}) {
+            auto src = noise(static_cast<size_t>(width) * 4,
+                             static_cast<uint32_t>(width));
+            for (bool planar : {false, true}) {
+                for (bool uyvy : {false, true}) {
+                    PackedOutput expected{width};
+                    PackedOutput actual{width};
+                    (uyvy ? scalar.uyvy : scalar.yuyv)(
+                        expected.rows(src, width, planar), width);
+                    (uyvy ? kernels.uyvy : kernels.yuyv)(
+                        actual.rows(src, width, planar), width);
+                    CHECK(actual == expected);
+                }
+            }
+        }
+    }
+}
+
+TEST(narrow_kernels_match_scalar) {
+    auto scalar = kernels_for(SimdLevel::scalar);
+    for (auto level : vector_levels()) {
+        auto kernels = kernels_for(level);
+        for (int count : {1, 7, 15, 17, 31, 33, 63, 65, 101}) {
+            auto src = noise(static_cast<size_t>(count) * 2,
+                             static_cast<uint32_t>(count));
+            std::vector<uint8_t> expected(static_cast<size_t>(count));
+            std::vector<uint8_t> actual(static_cast<size_t>(count));
+            scalar.narrow(src.data(), expected.data(), count);
+            kernels.narrow(src.data(), actual.data(), count);
+            CHECK(actual == expected);
+        }
+    }
+}
+
+// Odd heights convert their last row on its own, averaged with itself.
+TEST(converted_frames_match_scalar) {
+    fake_gl::install();
+    auto best = detect_simd_level();
+    for (auto [width, height] : {std::array{34, 7}, std::array{66, 5}}) {
+        auto packed = noise(static_cast<size_t>(width * 2 * height), 1);
+        for (auto layout : {YuvLayout::I420, YuvLayout::NV12}) {
+            auto expected = convert_frame(SimdLevel::scalar, 0,
+                                          SourceFormat::YUYV, layout, packed,
+                                          width, height);
+            CHECK(convert_frame(best, 2, SourceFormat::YUYV, layout, packed,
+                                width, height) == expected);
+        }
+    }
+}
+
+// At an odd width the chroma rows, and so the packed pitch, are a sample
+// longer than the luma rows.
+TEST(p010_frames_match_scalar) {
+    fake_gl::install();
+    auto best = detect_simd_level();
+    for (auto [width, height] : {std::array{33, 5}, std::array{66, 7}}) {
+        auto pitch = (width + 1) / 2 * 4;
+        auto p010  = noise(
+            static_cast<size_t>(pitch * (height + (height + 1) / 2)), 2);
+        auto expected = convert_frame(SimdLevel::scalar, 0, SourceFormat::P010,
+                                      YuvLayout::NV12, p010, width, height);
+        CHECK(convert_frame(best, 2, SourceFormat::P010, YuvLayout::NV12, p010,
+                            width, height) == expected);
+    }
+
+    YuvTexture texture{YuvLayout::NV12, 33, 5};
+    ColorConverter converter{SimdLevel::scalar, 0};
+    std::vector<std::byte> data(static_cast<size_t>(68 * 8));
+    auto frame = texture.begin_upload();
+    CHECK_THROWS(
+        converter.convert(SourceFormat::P010, data, 66, texture, frame));
+    converter.convert(SourceFormat::P010, data, 68, texture, frame);
+}
+
+TEST(pool_runs_every_index_once) {
+    for (unsigned threads : {0U, 1U, 3U}) {
+        ConversionPool pool{threads};
+        for (size_t count : {0UL, 1UL, 5UL, 100UL, 1000UL}) {
+            std::vector<std::atomic<int>> runs(count);
+            pool.run(count, 4, [&](size_t begin, size_t end) {
+                for (auto i = begin; i < end; i++) {
+                    runs[i]++;
+                }
+            });
+            auto once = true;
+            for (auto const& run : runs) {
+                once = once && run == 1;
+            }
+            CHECK(once);
+        }
+    }
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,91 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/damage.h>
+
+#include <algorithm>
+#include <memory>
+#include <span>
+
+using namespace renderer;
+
+namespace {
+auto contains(std::span<Rect const> damage, Rect const& rect) -> bool {
+    return std::ranges::any_of(damage, [&](Rect const& r) {
+        return r.x == rect.x && r.y == rect.y && r.width == rect.width &&
+               r.height == rect.height;
+    });
+}
+
+auto is_full(std::span<Rect const> damage) -> bool {
+    return damage.size() == 1 && contains(damage, {0, 0, 640, 480});
+}
+};  // namespace
+
+TEST(first_frame_is_full) {
+    DamageTracker tracker;
+    CHECK(is_full(tracker.end_frame(640, 480, 1)));
+}
+
+TEST(static_renderable_skips_frames) {
+    fake_gl::install();
+    auto texture = std::make_shared<Texture<GL_RGB>>(4, 4, 0);
+    Renderable<GL_RGB> still{nullptr, texture};
+    still.set_scale({100.0F, 100.0F});
+    still.set_position(PositionTopLeft, {10.0F, 20.0F, 0.0F});
+
+    DamageTracker tracker;
+    tracker.track(still);
+    tracker.end_frame(640, 480);
+    tracker.track(still);
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+
+    still.set_position(PositionTopLeft, {200.0F, 20.0F, 0.0F});
+    tracker.track(still);
+    auto damage = tracker.end_frame(640, 480, 1);
+    CHECK(contains(damage, {10, 20, 100, 100}));
+    CHECK(contains(damage, {200, 20, 100, 100}));
+}
+
+TEST(skipped_frames_keep_buffer_age_history) {
+    DamageTracker tracker;
+    tracker.end_frame(640, 480);
+
+    Rect first{10, 10, 20, 20};
+    tracker.invalidate(first);
+    CHECK(contains(tracker.end_frame(640, 480, 1), first));
+
+    // Skipped frames present nothing, so the buffer drawn before `first`
+    // is still two presents behind.
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+
+    Rect second{100, 100, 20, 20};
+    tracker.invalidate(second);
+    auto damage = tracker.end_frame(640, 480, 2);
+    CHECK(damage.size() == 2);
+    CHECK(contains(damage, first));
+    CHECK(contains(damage, second));
+}
+
+TEST(unknown_or_old_buffers_repaint_everything) {
+    DamageTracker tracker{2};
+    tracker.end_frame(640, 480);
+    tracker.invalidate({0, 0, 8, 8});
+    CHECK(is_full(tracker.end_frame(640, 480, 0)));
+    tracker.invalidate({0, 0, 8, 8});
+    CHECK(is_full(tracker.end_frame(640, 480, 3)));
+    tracker.invalidate({0, 0, 8, 8});
+    CHECK(!is_full(tracker.end_frame(640, 480, 2)));
+}
+
+TEST(resize_is_full) {
+    DamageTracker tracker;
+    tracker.end_frame(640, 480);
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+    CHECK(tracker.end_frame(800, 600, 1).size() == 1);
+}
+
+int main() {
+    return test::run_all();
+}
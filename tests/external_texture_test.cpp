@@ -0,0 +1,84 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/external_texture.h>
+
+#include <cstdint>
+
+using namespace renderer;
+
+namespace {
+// EGL whose `fail_at`th image import, counting from 1, fails.
+int images_created   = 0;
+int images_destroyed = 0;
+int fail_at          = 0;
+int textures_deleted = 0;
+
+auto create_image(EGLDisplay, EGLContext, EGLenum, EGLClientBuffer,
+                  EGLint const*) -> EGLImageKHR {
+    if (images_created + 1 >= fail_at) {
+        return EGL_NO_IMAGE_KHR;
+    }
+    images_created++;
+    return reinterpret_cast<EGLImageKHR>(uintptr_t{1});  // NOLINT
+}
+
+auto destroy_image(EGLDisplay, EGLImageKHR) -> EGLBoolean {
+    images_destroyed++;
+    return EGL_TRUE;
+}
+
+auto get_error() -> EGLint {
+    return EGL_BAD_MATCH;
+}
+
+auto image_target_texture(GLenum, void*) -> void {
+}
+
+auto delete_textures(GLsizei count, GLuint const*) -> void {
+    textures_deleted += count;
+}
+
+auto install() -> void {
+    fake_gl::install();
+    glad_glDeleteTextures = &delete_textures;
+    auto& functions                = detail::egl_image_functions();
+    functions.create_image         = &create_image;
+    functions.destroy_image        = &destroy_image;
+    functions.get_error            = &get_error;
+    functions.image_target_texture = &image_target_texture;
+    images_created   = 0;
+    images_destroyed = 0;
+    textures_deleted = 0;
+}
+
+auto nv12_frame() -> DmaBufFrame {
+    return {drm_format::nv12, 16, 16, {{{3, 0, 16}, {3, 256, 16}}}, 2};
+}
+};  // namespace
+
+TEST(planes_import_and_release) {
+    install();
+    fail_at = 3;
+    {
+        ExternalTexture texture{nullptr, nv12_frame(), ExternalSampling::Planes};
+        CHECK(texture.get_planes().size() == 2);
+        CHECK(texture.get_layout() == YuvLayout::NV12);
+    }
+    CHECK(images_destroyed == 2);
+    CHECK(textures_deleted == 2);
+}
+
+TEST(failed_plane_import_releases_the_earlier_ones) {
+    install();
+    fail_at = 2;
+    CHECK_THROWS(
+        ExternalTexture(nullptr, nv12_frame(), ExternalSampling::Planes));
+    CHECK(images_created == 1);
+    CHECK(images_destroyed == 1);
+    CHECK(textures_deleted == 1);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <glad/gles2.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Stand-in for a GL context, so the CPU side of the renderer runs without a
+// display: every entry point the renderer calls does nothing and returns
+// zero, except that objects get fresh names, buffers map to host memory,
+// status queries succeed, sync objects are counted and every program has
+// the uniforms listed in fake_gl::uniforms.
+namespace fake_gl {
+struct Counters {
+    std::atomic<int> fences_created;
+    std::atomic<int> fences_deleted;
+    std::atomic<int> fences_waited;
+    std::atomic<int> textures_bound;
+    std::atomic<int> uniforms_located;
+};
+
+inline auto counters() -> Counters& {
+    static Counters counters{};
+    return counters;
+}
+
+inline auto live_fences() -> int {
+    return counters().fences_created - counters().fences_deleted;
+}
+
+struct Uniform {
+    std::string_view name;
+    GLint size;
+    GLint location;  // of the first element; the rest follow
+};
+
+// Active in every program, as glGetActiveUniform reports them.
+inline constexpr Uniform uniforms[] = {
+    {"u_Projection", 1, 10},
+    {"u_Transform", 1, 11},
+    {"u_Planes[0]", 3, 12},
+};
+
+namespace detail {
+inline std::atomic<GLuint> next_name{1};
+inline std::atomic<uintptr_t> next_fence{1};
+
+template <typename R, typename... Args>
+auto GLAD_API_PTR nothing(Args...) -> R {
+    if constexpr (!std::is_void_v<R>) {
+        return R{};
+    }
+}
+
+template <typename R, typename... Args>
+auto stub(R(GLAD_API_PTR*& function)(Args...)) -> void {
+    function = &nothing<R, Args...>;
+}
+
+inline auto GLAD_API_PTR gen_names(GLsizei count, GLuint* names) -> void {
+    for (GLsizei i = 0; i < count; i++) {
+        names[i] = next_name++;
+    }
+}
+
+inline auto GLAD_API_PTR create_name(auto...) -> GLuint {
+    return next_name++;
+}
+
+inline auto GLAD_API_PTR get_iv(GLuint, GLenum name, GLint* value) -> void {
+    bool status = name == GL_COMPILE_STATUS || name == GL_LINK_STATUS;
+    *value      = status ? GL_TRUE : 0;
+}
+
+inline auto GLAD_API_PTR get_program_iv(GLuint program, GLenum name,
+                                        GLint* value) -> void {
+    if (name == GL_ACTIVE_UNIFORMS) {
+        *value = std::size(uniforms);
+    } else if (name == GL_ACTIVE_UNIFORM_MAX_LENGTH) {
+        *value = 32;
+    } else {
+        get_iv(program, name, value);
+    }
+}
+
+inline auto GLAD_API_PTR get_active_uniform(GLuint, GLuint index,
+                                            GLsizei buffer_size,
+                                            GLsizei* length, GLint* size,
+                                            GLenum* type, GLchar* name)
+    -> void {
+    auto const& uniform = uniforms[index];
+    auto count = std::min(uniform.name.size(),
+                          static_cast<size_t>(buffer_size - 1));
+    std::memcpy(name, uniform.name.data(), count);
+    name[count] = '\0';
+    *length     = static_cast<GLsizei>(count);
+    *size       = uniform.size;
+    *type       = GL_FLOAT_MAT4;
+}
+
+inline auto GLAD_API_PTR get_uniform_location(GLuint, GLchar const* name)
+    -> GLint {
+    counters().uniforms_located++;
+    std::string_view wanted{name};
+    for (auto const& uniform : uniforms) {
+        auto base = uniform.name.substr(0, uniform.name.find('['));
+        if (wanted == uniform.name || wanted == base) {
+            return uniform.location;
+        }
+        for (GLint i = 1; i < uniform.size; i++) {
+            if (wanted == std::string{base} + "[" + std::to_string(i) + "]") {
+                return uniform.location + i;
+            }
+        }
+    }
+    return -1;
+}
+
+inline auto GLAD_API_PTR map_buffer(GLenum, GLintptr, GLsizeiptr length,
+                                    GLbitfield) -> void* {
+    thread_local std::vector<std::byte> memory;
+    memory.resize(static_cast<size_t>(length));
+    return memory.data();
+}
+
+inline auto GLAD_API_PTR unmap_buffer(GLenum) -> GLboolean {
+    return GL_TRUE;
+}
+
+inline auto GLAD_API_PTR fence_sync(GLenum, GLbitfield) -> GLsync {
+    counters().fences_created++;
+    return reinterpret_cast<GLsync>(next_fence++);  // NOLINT
+}
+
+inline auto GLAD_API_PTR delete_sync(GLsync) -> void {
+    counters().fences_deleted++;
+}
+
+inline auto GLAD_API_PTR wait_sync(GLsync, GLbitfield, GLuint64) -> void {
+    counters().fences_waited++;
+}
+
+inline auto GLAD_API_PTR client_wait_sync(GLsync, GLbitfield, GLuint64)
+    -> GLenum {
+    return GL_ALREADY_SIGNALED;
+}
+
+inline auto GLAD_API_PTR bind_texture(GLenum, GLuint) -> void {
+    counters().textures_bound++;
+}
+
+// The element array binding is VAO state; remember it per VAO, and which
+// one the last draw used.
+inline thread_local GLuint vertex_array = 0;
+inline thread_local std::unordered_map<GLuint, GLuint> element_buffers;
+inline thread_local GLuint drawn_element_buffer = 0;
+
+inline auto GLAD_API_PTR bind_vertex_array(GLuint vao) -> void {
+    vertex_array = vao;
+}
+
+inline auto GLAD_API_PTR bind_buffer(GLenum target, GLuint buffer) -> void {
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        element_buffers[vertex_array] = buffer;
+    }
+}
+
+inline auto GLAD_API_PTR draw_elements(GLenum, GLsizei, GLenum, void const*)
+    -> void {
+    drawn_element_buffer = element_buffers[vertex_array];
+}
+
+inline thread_local GLuint used_program = 0;
+
+inline auto GLAD_API_PTR use_program(GLuint program) -> void {
+    used_program = program;
+}
+
+inline auto GLAD_API_PTR framebuffer_status(GLenum) -> GLenum {
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+};  // namespace detail
+
+// Index buffer the last glDrawElements() on this thread read from.
+inline auto drawn_element_buffer() -> GLuint {
+    return detail::drawn_element_buffer;
+}
+
+// Program the last glUseProgram() on this thread made current.
+inline auto used_program() -> GLuint {
+    return detail::used_program;
+}
+
+inline auto install() -> void {
+    detail::stub(glad_glActiveTexture);
+    detail::stub(glad_glAttachShader);
+    detail::stub(glad_glBeginQuery);
+    detail::stub(glad_glBindAttribLocation);
+    detail::stub(glad_glBindBuffer);
+    detail::stub(glad_glBindBufferBase);
+    detail::stub(glad_glBindBufferRange);
+    detail::stub(glad_glBindFramebuffer);
+    detail::stub(glad_glBindRenderbuffer);
+    detail::stub(glad_glBindTexture);
+    detail::stub(glad_glBindVertexArray);
+    detail::stub(glad_glBlitFramebuffer);
+    detail::stub(glad_glBufferData);
+    detail::stub(glad_glBufferSubData);
+    detail::stub(glad_glCheckFramebufferStatus);
+    detail::stub(glad_glClientWaitSync);
+    detail::stub(glad_glCompileShader);
+    detail::stub(glad_glCreateProgram);
+    detail::stub(glad_glCreateShader);
+    detail::stub(glad_glDeleteBuffers);
+    detail::stub(glad_glDeleteFramebuffers);
+    detail::stub(glad_glDeleteProgram);
+    detail::stub(glad_glDeleteQueries);
+    detail::stub(glad_glDeleteRenderbuffers);
+    detail::stub(glad_glDeleteShader);
+    detail::stub(glad_glDeleteSync);
+    detail::stub(glad_glDeleteTextures);
+    detail::stub(glad_glDeleteVertexArrays);
+    detail::stub(glad_glDetachShader);
+    detail::stub(glad_glDisableVertexAttribArray);
+    detail::stub(glad_glDrawElements);
+    detail::stub(glad_glDrawElementsInstanced);
+    detail::stub(glad_glEnableVertexAttribArray);
+    detail::stub(glad_glEndQuery);
+    detail::stub(glad_glFenceSync);
+    detail::stub(glad_glFlush);
+    detail::stub(glad_glFramebufferRenderbuffer);
+    detail::stub(glad_glFramebufferTexture2D);
+    detail::stub(glad_glGenBuffers);
+    detail::stub(glad_glGenFramebuffers);
+    detail::stub(glad_glGenQueries);
+    detail::stub(glad_glGenRenderbuffers);
+    detail::stub(glad_glGenTextures);
+    detail::stub(glad_glGenVertexArrays);
+    detail::stub(glad_glGetActiveAttrib);
+    detail::stub(glad_glGetAttribLocation);
+    detail::stub(glad_glGetIntegerv);
+    detail::stub(glad_glGetProgramBinary);
+    detail::stub(glad_glGetProgramInfoLog);
+    detail::stub(glad_glGetProgramiv);
+    detail::stub(glad_glGetQueryObjectuiv);
+    detail::stub(glad_glGetShaderInfoLog);
+    detail::stub(glad_glGetShaderiv);
+    detail::stub(glad_glGetString);
+    detail::stub(glad_glGetStringi);
+    detail::stub(glad_glGetUniformBlockIndex);
+    detail::stub(glad_glGetUniformLocation);
+    detail::stub(glad_glInvalidateFramebuffer);
+    detail::stub(glad_glLinkProgram);
+    detail::stub(glad_glMapBufferRange);
+    detail::stub(glad_glPixelStorei);
+    detail::stub(glad_glProgramBinary);
+    detail::stub(glad_glProgramParameteri);
+    detail::stub(glad_glRenderbufferStorageMultisample);
+    detail::stub(glad_glScissor);
+    detail::stub(glad_glShaderSource);
+    detail::stub(glad_glTexImage2D);
+    detail::stub(glad_glTexImage3D);
+    detail::stub(glad_glTexParameteri);
+    detail::stub(glad_glTexSubImage2D);
+    detail::stub(glad_glTexSubImage3D);
+    detail::stub(glad_glUniform1f);
+    detail::stub(glad_glUniform1i);
+    detail::stub(glad_glUniformBlockBinding);
+    detail::stub(glad_glUniformMatrix4fv);
+    detail::stub(glad_glUnmapBuffer);
+    detail::stub(glad_glUseProgram);
+    detail::stub(glad_glVertexAttrib1f);
+    detail::stub(glad_glVertexAttribDivisor);
+    detail::stub(glad_glVertexAttribPointer);
+    detail::stub(glad_glViewport);
+    detail::stub(glad_glWaitSync);
+
+    glad_glGenBuffers             = &detail::gen_names;
+    glad_glGenTextures            = &detail::gen_names;
+    glad_glGenVertexArrays        = &detail::gen_names;
+    glad_glGenFramebuffers        = &detail::gen_names;
+    glad_glGenRenderbuffers       = &detail::gen_names;
+    glad_glGenQueries             = &detail::gen_names;
+    glad_glCreateProgram          = &detail::create_name<>;
+    glad_glCreateShader           = &detail::create_name<GLenum>;
+    glad_glGetShaderiv            = &detail::get_iv;
+    glad_glGetProgramiv           = &detail::get_program_iv;
+    glad_glGetActiveUniform       = &detail::get_active_uniform;
+    glad_glGetUniformLocation     = &detail::get_uniform_location;
+    glad_glMapBufferRange         = &detail::map_buffer;
+    glad_glUnmapBuffer            = &detail::unmap_buffer;
+    glad_glFenceSync              = &detail::fence_sync;
+    glad_glDeleteSync             = &detail::delete_sync;
+    glad_glWaitSync               = &detail::wait_sync;
+    glad_glClientWaitSync         = &detail::client_wait_sync;
+    glad_glBindTexture            = &detail::bind_texture;
+    glad_glCheckFramebufferStatus = &detail::framebuffer_status;
+    glad_glBindVertexArray        = &detail::bind_vertex_array;
+    glad_glBindBuffer             = &detail::bind_buffer;
+    glad_glDrawElements           = &detail::draw_elements;
+    glad_glUseProgram             = &detail::use_program;
+}
+
+// For fixtures whose members create GL objects: list it first.
+struct Context {
+    Context() {
+        install();
+    }
+};
+};  // namespace fake_gl
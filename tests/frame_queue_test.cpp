@@ -0,0 +1,102 @@
+#include "test.h"
+
+#include <wnlrenderer/frame_queue.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+using namespace renderer;
+using namespace std::chrono_literals;
+
+namespace {
+struct Frame {
+    PresentClock::time_point pts;
+    uint64_t number;
+};
+};  // namespace
+
+TEST(queue_is_bounded_and_in_order) {
+    FrameQueue<uint64_t, 4> queue;
+    CHECK(queue.front() == nullptr);
+    CHECK(!queue.try_pop());
+
+    for (uint64_t i = 0; i < 4; i++) {
+        CHECK(queue.try_push(i));
+    }
+    CHECK(!queue.try_push(4));
+
+    CHECK(*queue.front() == 0);
+    queue.pop();
+    CHECK(queue.try_push(4));
+    for (uint64_t i = 1; i <= 4; i++) {
+        CHECK(queue.try_pop() == i);
+    }
+    CHECK(!queue.try_pop());
+}
+
+TEST(queue_hands_over_across_threads) {
+    constexpr uint64_t count = 100'000;
+    FrameQueue<uint64_t, 8> queue;
+    std::thread producer{[&] {
+        for (uint64_t i = 0; i < count;) {
+            if (queue.try_push(i)) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    uint64_t expected = 0;
+    bool in_order     = true;
+    while (expected < count) {
+        if (auto value = queue.try_pop()) {
+            in_order = in_order && *value == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(in_order);
+}
+
+TEST(pacer_shows_the_newest_due_frame) {
+    auto vsync = PresentClock::now();
+    FrameQueue<Frame, 8> queue;
+    queue.try_push({vsync - 20ms, 0});
+    queue.try_push({vsync - 10ms, 1});
+    queue.try_push({vsync, 2});
+    queue.try_push({vsync + 30ms, 3});
+
+    FramePacer<Frame> pacer{16ms};
+    auto chosen = pacer.select(queue, vsync);
+    CHECK(chosen && chosen->number == 2);
+    CHECK(pacer.get_stats().dropped == 2);
+
+    // Not due yet: keep showing the current frame.
+    CHECK(!pacer.select(queue, vsync + 16ms));
+    CHECK(pacer.get_stats().held == 1);
+    chosen = pacer.select(queue, vsync + 32ms);
+    CHECK(chosen && chosen->number == 3);
+    CHECK(pacer.get_stats().presented == 2);
+}
+
+TEST(pacer_follows_the_measured_refresh) {
+    FramePacer<Frame> pacer{16ms};
+    auto swapped = PresentClock::now();
+    for (int i = 0; i < 64; i++) {
+        pacer.on_present(swapped);
+        swapped += 8ms;
+    }
+    CHECK(pacer.get_refresh_interval() < 9ms);
+
+    // A stall is not taken for a slower display.
+    pacer.on_present(swapped + 100ms);
+    CHECK(pacer.get_refresh_interval() < 9ms);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,52 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/gl_state.h>
+
+#include <thread>
+
+using namespace renderer;
+
+namespace {
+// Binds `texture` to unit 0 and returns whether the bind reached GL.
+auto bind_issued(GLuint texture) -> bool {
+    auto issued = gl_state().get_stats().issued;
+    gl_state().bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+    return gl_state().get_stats().issued > issued;
+}
+};  // namespace
+
+TEST(redundant_binds_are_skipped) {
+    fake_gl::install();
+    gl_state().reset();
+    CHECK(bind_issued(5));
+    CHECK(!bind_issued(5));
+    CHECK(bind_issued(6));
+
+    gl_state().forget_texture(6);
+    CHECK(bind_issued(6));
+}
+
+TEST(forgetting_on_another_thread_drops_shared_bindings) {
+    fake_gl::install();
+    gl_state().reset();
+    gl_state().bind_vertex_array(3);
+    CHECK(bind_issued(5));
+    CHECK(!bind_issued(5));
+
+    // Deleted on another context, and the name may come back as a new
+    // texture; this context still has the old one bound.
+    std::thread other{[] { gl_state().forget_texture(5); }};
+    other.join();
+    CHECK(bind_issued(5));
+    CHECK(!bind_issued(5));
+
+    // Vertex arrays are not shared, so their binding stays known.
+    auto skipped = gl_state().get_stats().skipped;
+    gl_state().bind_vertex_array(3);
+    CHECK(gl_state().get_stats().skipped == skipped + 1);
+}
+
+int main() {
+    return test::run_all();
+}
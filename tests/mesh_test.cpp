@@ -0,0 +1,54 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/renderer.h>
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+using namespace renderer;
+
+namespace {
+auto make_quad() -> Mesh {
+    return Mesh{std::span{vertices}, std::span{indices}};
+}
+};  // namespace
+
+TEST(creating_a_mesh_keeps_the_drawn_index_buffer) {
+    fake_gl::install();
+    gl_state().reset();
+    auto first = make_quad();
+    first.draw();
+    auto drawn = fake_gl::drawn_element_buffer();
+    CHECK(drawn != 0);
+
+    // Its VAO is still bound while the second uploads its indices.
+    auto second = make_quad();
+    first.draw();
+    CHECK(fake_gl::drawn_element_buffer() == drawn);
+    second.draw();
+    CHECK(fake_gl::drawn_element_buffer() != drawn);
+}
+
+TEST(streaming_indices_keeps_the_drawn_index_buffer) {
+    fake_gl::install();
+    gl_state().reset();
+    auto mesh = make_quad();
+    mesh.draw();
+    auto drawn = fake_gl::drawn_element_buffer();
+
+    DynamicBuffer stream{GL_ELEMENT_ARRAY_BUFFER};
+    std::array<std::byte, 12> data{};
+    stream.set_data(data);
+    BufferRing ring{GL_ELEMENT_ARRAY_BUFFER, 64};
+    ring.begin_frame();
+    ring.stream(data);
+
+    mesh.draw();
+    CHECK(fake_gl::drawn_element_buffer() == drawn);
+}
+
+int main() {
+    return test::run_all();
+}
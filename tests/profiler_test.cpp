@@ -0,0 +1,168 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/profiler.h>
+#include <wnlrenderer/renderer.h>
+
+#include <chrono>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace renderer;
+
+namespace {
+// Timer queries that take 1 µs each, once `available`.
+bool available = false;
+bool disjoint  = false;
+
+auto GLAD_API_PTR query_available(GLuint, GLenum, GLuint* value) -> void {
+    *value = available ? 1 : 0;
+}
+
+auto GLAD_API_PTR query_result(GLuint, GLenum, GLuint64* value) -> void {
+    *value = 1000;
+}
+
+auto GLAD_API_PTR get_disjoint(GLenum name, GLint* value) -> void {
+    *value = name == GL_GPU_DISJOINT_EXT && disjoint ? 1 : 0;
+}
+
+struct TimerQueries {
+    TimerQueries() {
+        glad_glGetQueryObjectuiv = &query_available;
+        glad_glGetIntegerv       = &get_disjoint;
+        detail::timer_query_functions().get_query_object_ui64 = &query_result;
+        available = false;
+        disjoint  = false;
+    }
+
+    ~TimerQueries() {
+        detail::timer_query_functions().get_query_object_ui64 = nullptr;
+    }
+
+    fake_gl::Context context;
+};
+
+auto gpu_frame(Profiler& profiler, int zones) -> void {
+    profiler.begin_frame();
+    for (int i = 0; i < zones; i++) {
+        GpuZone zone{"draw"};
+        GpuZone nested{"nested"};  // not recorded
+    }
+    profiler.end_frame();
+}
+};  // namespace
+
+TEST(frames_count_work_and_cpu_zones) {
+    fake_gl::install();
+    Texture<GL_RGBA> texture{4, 4, 1};
+    std::vector<std::byte> pixels(4 * 4 * 4);
+
+    Profiler profiler;
+    profiler.attach();
+    CHECK(profiler.counters() == nullptr);
+    profiler.begin_frame();
+    {
+        CpuZone zone{"upload"};
+        texture.copy_data(pixels, 0);
+    }
+    {
+        GpuZone zone{"draw"};  // no timer queries: no zone
+    }
+    profiler.end_frame();
+
+    auto const* frame = profiler.latest();
+    CHECK(frame != nullptr);
+    CHECK(frame->frame == 0);
+    CHECK(frame->counters.bytes_uploaded == pixels.size());
+    CHECK(!frame->gpu_time);
+    CHECK(frame->gpu_zones.empty());
+    // copy_data() times itself too, inside the zone around it.
+    CHECK(frame->cpu_zones.size() == 2);
+    CHECK(std::string{frame->cpu_zones.back().name} == "upload");
+
+    profiler.detach();
+    profiler.begin_frame();
+    texture.copy_data(pixels, 0);
+    profiler.end_frame();
+    CHECK(profiler.latest()->counters.bytes_uploaded == 0);
+}
+
+TEST(history_is_capped) {
+    fake_gl::install();
+    Profiler profiler{3};
+    for (int i = 0; i < 5; i++) {
+        profiler.begin_frame();
+        profiler.end_frame();
+    }
+    CHECK(profiler.frames().size() == 3);
+    CHECK(profiler.frames().front().frame == 2);
+    CHECK(profiler.take_frames().size() == 3);
+    CHECK(profiler.frames().empty());
+}
+
+TEST(gpu_results_are_read_once_available) {
+    TimerQueries queries;
+    Profiler profiler{240, 2};
+    profiler.attach();
+
+    gpu_frame(profiler, 2);
+    CHECK(profiler.frames().empty());  // still in flight
+    available = true;
+    gpu_frame(profiler, 1);
+
+    CHECK(profiler.frames().size() == 2);
+    auto const& first = profiler.frames().front();
+    CHECK(first.gpu_zones.size() == 2);
+    CHECK(first.gpu_time == std::chrono::nanoseconds{2000});
+    CHECK(profiler.frames().back().gpu_time ==
+          std::chrono::nanoseconds{1000});
+}
+
+TEST(overdue_and_disjoint_results_are_dropped) {
+    TimerQueries queries;
+    Profiler profiler{240, 2};
+    profiler.attach();
+
+    for (int i = 0; i < 3; i++) {
+        gpu_frame(profiler, 1);
+    }
+    // Past the latency, the oldest frame is given up on.
+    CHECK(profiler.frames().size() == 1);
+    CHECK(!profiler.frames().front().gpu_time);
+
+    available = true;
+    disjoint  = true;
+    gpu_frame(profiler, 1);
+    CHECK(profiler.frames().size() == 4);
+    for (auto const& frame : profiler.frames()) {
+        CHECK(!frame.gpu_time);
+    }
+}
+
+TEST(chrome_trace_has_every_event) {
+    fake_gl::install();
+    Profiler profiler;
+    profiler.attach();
+    for (int i = 0; i < 2; i++) {
+        profiler.begin_frame();
+        {
+            CpuZone zone{"work"};
+        }
+        profiler.end_frame();
+    }
+    std::ostringstream out;
+    profiler.write_chrome_trace(out);
+    auto json = out.str();
+    CHECK(json.starts_with(R"({"displayTimeUnit":"ms","traceEvents":[)"));
+    CHECK(json.ends_with("]}\n"));
+    CHECK(json.find(R"("name":"frame 1")") != std::string::npos);
+    CHECK(json.find(R"("name":"work")") != std::string::npos);
+    CHECK(json.find(R"("name":"counters")") != std::string::npos);
+}
+
+int main() {
+    return test::run_all();
+}
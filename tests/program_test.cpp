@@ -0,0 +1,122 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/renderer.h>
+
+#include <thread>
+#include <vector>
+
+using namespace renderer;
+
+namespace {
+std::atomic<int> shaders_deleted{0};
+std::atomic<int> programs_deleted{0};
+
+auto GLAD_API_PTR create_vertex_shader_only(GLenum type) -> GLuint {
+    return type == GL_VERTEX_SHADER ? 100 : 0;
+}
+
+auto GLAD_API_PTR delete_shader(GLuint shader) -> void {
+    if (shader != 0) {
+        shaders_deleted++;
+    }
+}
+
+auto GLAD_API_PTR delete_program(GLuint program) -> void {
+    if (program != 0) {
+        programs_deleted++;
+    }
+}
+
+GLuint unlinkable = 0;
+
+auto GLAD_API_PTR get_program_iv(GLuint program, GLenum name, GLint* value)
+    -> void {
+    fake_gl::detail::get_program_iv(program, name, value);
+    if (name == GL_LINK_STATUS && program == unlinkable) {
+        *value = GL_FALSE;
+    }
+}
+};  // namespace
+
+TEST(uniforms_are_located_at_link) {
+    fake_gl::install();
+    ShaderProgram program{"void main() {}", "void main() {}"};
+    auto located = fake_gl::counters().uniforms_located.load();
+
+    CHECK(program.get_uniform_location<"u_Transform">() == 11);
+    CHECK(program.get_uniform<glm::mat4>("u_Projection").location == 10);
+    CHECK(program.get_uniform<float>("u_Planes").location == 12);
+    CHECK(program.get_uniform<float>("u_Planes[2]").location == 14);
+    CHECK(program.get_uniform<float>("u_Planes[3]").location == -1);
+    CHECK(program.get_uniform_location<"u_Missing">() == -1);
+    CHECK(fake_gl::counters().uniforms_located == located);
+}
+
+TEST(fixed_locations_are_shared_between_threads) {
+    fake_gl::install();
+    ShaderProgram program{"void main() {}", "void main() {}"};
+
+    std::vector<std::jthread> threads;
+    std::atomic<int> wrong{0};
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 1000; j++) {
+                if (program.get_uniform_location<"u_Projection">() != 10 ||
+                    program.get_uniform_location<"u_Transform">() != 11) {
+                    wrong++;
+                }
+            }
+        });
+    }
+    threads.clear();
+    CHECK(wrong == 0);
+}
+
+TEST(failing_to_start_a_link_releases_what_it_made) {
+    fake_gl::install();
+    glad_glCreateShader  = &create_vertex_shader_only;
+    glad_glDeleteShader  = &delete_shader;
+    glad_glDeleteProgram = &delete_program;
+
+    CHECK_THROWS(ShaderProgram("void main() {}", "void main() {}"));
+    CHECK_THROWS(
+        (void)ShaderProgram::deferred("void main() {}", "void main() {}"));
+    CHECK(shaders_deleted == 2);
+    CHECK(programs_deleted == 2);
+}
+
+TEST(program_slot_swaps_in_the_replacement) {
+    fake_gl::install();
+    ProgramSlot slot{ShaderProgram{"void main() {}", "void main() {}"}};
+    auto first = slot.current().get_id();
+    slot.current().use();
+    CHECK(fake_gl::used_program() == first);
+
+    slot.replace(ShaderProgram::deferred("void main() {}", "void main() {}"));
+    CHECK(slot.is_pending());
+    auto second = slot.current().get_id();
+    CHECK(second != first);
+    CHECK(!slot.is_pending());
+    slot.current().use();
+    CHECK(fake_gl::used_program() == second);
+}
+
+TEST(program_slot_keeps_its_program_when_the_replacement_fails) {
+    fake_gl::install();
+    glad_glGetProgramiv = &get_program_iv;
+    ProgramSlot slot{ShaderProgram{"void main() {}", "void main() {}"}};
+    auto first = slot.current().get_id();
+
+    auto broken = ShaderProgram::deferred("void main() {}", "void main() {}");
+    unlinkable = broken.get_id();
+    slot.replace(std::move(broken));
+    CHECK_THROWS(slot.current());
+    CHECK(!slot.is_pending());
+    slot.current().use();
+    CHECK(fake_gl::used_program() == first);
+}
+
+int main() {
+    return test::run_all();
+}
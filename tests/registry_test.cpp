@@ -0,0 +1,162 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/batch.h>
+#include <wnlrenderer/command_buffer.h>
+#include <wnlrenderer/damage.h>
+#include <wnlrenderer/registry.h>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+using namespace renderer;
+
+namespace {
+auto sprite_at(MeshHandle mesh,
+               TextureHandle texture,
+               glm::vec3 position,
+               glm::vec2 scale) -> Sprite {
+    return {mesh, texture, 0.0F, position, scale, true};
+}
+};  // namespace
+
+TEST(removed_handles_go_stale) {
+    fake_gl::install();
+    ResourceRegistry registry;
+    auto texture = registry.add_texture(
+        std::make_shared<Texture<GL_RGBA>>(4, 4, 0));
+    CHECK(registry.is_valid(texture));
+
+    registry.remove(texture);
+    CHECK(!registry.is_valid(texture));
+    CHECK_THROWS(registry.get_binding(texture));
+
+    // The slot is reused under a new generation; the old handle stays dead.
+    auto reused = registry.add_texture(
+        std::make_shared<Texture<GL_RGBA>>(4, 4, 0));
+    CHECK(reused.get_index() == texture.get_index());
+    CHECK(reused.get_generation() != texture.get_generation());
+    CHECK(registry.is_valid(reused));
+    CHECK(!registry.is_valid(texture));
+    CHECK(!registry.is_valid(TextureHandle{}));
+}
+
+TEST(registry_holds_one_reference_until_removed) {
+    fake_gl::install();
+    ResourceRegistry registry;
+    auto texture = std::make_shared<Texture<GL_RGBA>>(4, 4, 0);
+    auto handle  = registry.add_texture(texture);
+    CHECK(texture.use_count() == 2);
+    CHECK(registry.get_binding(handle).textures[0] == texture->get_id());
+    registry.remove(handle);
+    CHECK(texture.use_count() == 1);
+}
+
+TEST(sprite_damage_follows_fields_and_contents) {
+    fake_gl::install();
+    ResourceRegistry registry;
+    auto texture = std::make_shared<Texture<GL_RGBA>>(4, 4);
+    auto sprite  = registry.add_sprite(
+        sprite_at(registry.add_mesh(nullptr), registry.add_texture(texture),
+                  {50.0F, 50.0F, 0.0F}, {20.0F, 20.0F}));
+
+    DamageTracker tracker;
+    tracker.track(registry, sprite);
+    tracker.end_frame(640, 480);
+    tracker.track(registry, sprite);
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+
+    registry.get_sprite(sprite).layer = 1.0F;
+    tracker.track(registry, sprite);
+    CHECK(tracker.end_frame(640, 480, 1).size() == 2);
+
+    std::vector<std::byte> pixels(4 * 4 * 4);
+    texture->copy_data(pixels, 0);
+    tracker.track(registry, sprite);
+    CHECK(!tracker.end_frame(640, 480, 1).empty());
+
+    tracker.track(registry, sprite);
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+}
+
+TEST(sprites_are_known_by_handle) {
+    fake_gl::install();
+    ResourceRegistry registry;
+    auto mesh    = registry.add_mesh(nullptr);
+    auto texture = registry.add_texture(
+        std::make_shared<Texture<GL_RGBA>>(4, 4, 0));
+
+    // The registry's storage moves as sprites are added; damage does not
+    // follow the address.
+    auto first = registry.add_sprite(
+        sprite_at(mesh, texture, {50.0F, 50.0F, 0.0F}, {20.0F, 20.0F}));
+    DamageTracker tracker;
+    tracker.track(registry, first);
+    tracker.end_frame(640, 480);
+    for (int i = 0; i < 64; i++) {
+        registry.add_sprite(
+            sprite_at(mesh, texture, {0.0F, 0.0F, 0.0F}, {1.0F, 1.0F}));
+    }
+    tracker.track(registry, first);
+    CHECK(tracker.end_frame(640, 480, 1).empty());
+
+    registry.remove(first);
+    CHECK(!registry.is_valid(first));
+    CHECK_THROWS(tracker.track(registry, first));
+}
+
+TEST(batch_culls_covered_sprites) {
+    fake_gl::install();
+    ResourceRegistry registry;
+    auto mesh    = registry.add_mesh(
+        std::make_shared<Mesh>(std::span{vertices}, std::span{indices}));
+    auto texture = registry.add_texture(
+        std::make_shared<Texture<GL_RGBA>>(4, 4, 0));
+    ShaderProgram program{"void main() {}", "void main() {}"};
+
+    auto cover   = registry.add_sprite(sprite_at(
+        mesh, texture, {320.0F, 240.0F, 1.0F}, {640.0F, 480.0F}));
+    auto covered = registry.add_sprite(sprite_at(
+        mesh, texture, {100.0F, 100.0F, 0.0F}, {20.0F, 20.0F}));
+    auto glass   = registry.add_sprite(sprite_at(
+        mesh, texture, {320.0F, 240.0F, 2.0F}, {640.0F, 480.0F}));
+    registry.get_sprite(glass).opaque = false;
+
+    BatchRenderer batch;
+    for (auto sprite : {covered, cover, glass}) {
+        batch.submit(program, registry, sprite);
+    }
+    batch.cull(glm::ortho(0.0F, 640.0F, 480.0F, 0.0F));
+    CHECK(batch.is_visible(registry, cover));
+    CHECK(batch.is_visible(registry, glass));
+    CHECK(!batch.is_visible(registry, covered));
+
+    batch.flush();
+    CHECK(batch.get_culled() == 1);
+    CHECK(batch.get_draw_calls() == 2);  // one per z
+}
+
+TEST(command_buffer_records_sprites) {
+    fake_gl::install();
+    ResourceRegistry registry;
+    auto mesh    = registry.add_mesh(
+        std::make_shared<Mesh>(std::span{vertices}, std::span{indices}));
+    auto texture = registry.add_texture(
+        std::make_shared<Texture<GL_RGBA>>(4, 4, 0));
+    ShaderProgram program{"void main() {}", "void main() {}"};
+
+    CommandBuffer commands{4};
+    auto sprite = sprite_at(mesh, texture, {0.0F, 0.0F, 0.0F}, {1.0F, 1.0F});
+    commands.record(0, program, registry, sprite);
+    CHECK(commands.size() == 1);
+
+    registry.remove(texture);
+    CHECK_THROWS(commands.record(0, program, registry, sprite));
+    CHECK(commands.size() == 1);
+}
+
+int main() {
+    return test::run_all();
+}
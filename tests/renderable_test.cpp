@@ -0,0 +1,67 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/renderer.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace renderer;
+
+TEST(getters_return_the_constructed_source) {
+    fake_gl::install();
+    auto texture = std::make_shared<Texture<GL_RGBA>>(4, 4, 0);
+    Renderable renderable{nullptr, texture};
+
+    CHECK(renderable.get_texture() == texture);
+    CHECK(&renderable.get_texture() == &renderable.get_texture());
+    CHECK(renderable.get_texture_array() == nullptr);
+#ifdef WNLRENDERER_EGL
+    CHECK(renderable.get_external_texture() == nullptr);
+#endif
+    CHECK(renderable.get_texture_target() == GL_TEXTURE_2D);
+    CHECK(renderable.get_texture_ids()[0] == texture->get_id());
+    CHECK(texture.use_count() == 2);
+}
+
+TEST(planar_sources_report_every_plane) {
+    fake_gl::install();
+    auto y  = std::make_shared<Texture<GL_RED>>(4, 4, 0);
+    auto u  = std::make_shared<Texture<GL_RED>>(2, 2, 0);
+    auto v  = std::make_shared<Texture<GL_RED>>(2, 2, 0);
+    auto uv = std::make_shared<Texture<GL_RG>>(2, 2, 0);
+
+    Renderable<GL_RED> planar{nullptr, y, u, v};
+    auto [planar_y, planar_u, planar_v] = planar.get_texture();
+    CHECK(planar_y == y && planar_u == u && planar_v == v);
+    CHECK(planar.get_yuv_texture() == nullptr);
+    auto ids = planar.get_texture_ids();
+    CHECK(ids[0] == y->get_id() && ids[1] == u->get_id() &&
+          ids[2] == v->get_id());
+
+    Renderable<GL_RED> semi_planar{nullptr, y, uv};
+    auto [luma, none_u, none_v] = semi_planar.get_texture();
+    CHECK(luma == y && none_u == nullptr && none_v == nullptr);
+    ids = semi_planar.get_texture_ids();
+    CHECK(ids[0] == y->get_id() && ids[1] == uv->get_id() && ids[2] == 0);
+}
+
+TEST(revision_follows_textures_and_placement) {
+    fake_gl::install();
+    auto texture = std::make_shared<Texture<GL_RGB>>(4, 4);
+    Renderable renderable{nullptr, texture};
+    auto revision = renderable.get_revision();
+
+    renderable.set_scale({2.0F, 2.0F});
+    CHECK(renderable.get_revision() != revision);
+    revision = renderable.get_revision();
+
+    std::vector<std::byte> pixels(4 * 4 * 3);
+    texture->copy_data(pixels, 0);
+    CHECK(renderable.get_revision() != revision);
+}
+
+int main() {
+    return test::run_all();
+}
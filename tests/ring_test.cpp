@@ -0,0 +1,47 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/renderer.h>
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+using namespace renderer;
+
+TEST(uniform_ring_fences_do_not_leak) {
+    fake_gl::install();
+    auto live = fake_gl::live_fences();
+    {
+        UniformRing<DrawUniforms> ring{uniform_block::draw, 2};
+        std::array<DrawUniforms, 1> draws{};
+        for (int frame = 0; frame < 4; frame++) {
+            ring.upload(draws);
+            ring.fence();
+            ring.fence();  // e.g. a second pass over the same uniforms
+        }
+        CHECK(fake_gl::live_fences() <= live + 3);  // one per segment
+    }
+    CHECK(fake_gl::live_fences() == live);
+}
+
+TEST(buffer_ring_fences_do_not_leak) {
+    fake_gl::install();
+    auto live = fake_gl::live_fences();
+    {
+        BufferRing ring{GL_ARRAY_BUFFER, 64, 2};
+        std::array<std::byte, 16> data{};
+        for (int frame = 0; frame < 4; frame++) {
+            ring.begin_frame();
+            ring.stream(data);
+            ring.end_frame();
+            ring.end_frame();
+        }
+        CHECK(fake_gl::live_fences() <= live + 2);
+    }
+    CHECK(fake_gl::live_fences() == live);
+}
+
+int main() {
+    return test::run_all();
+}
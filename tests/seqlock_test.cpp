@@ -0,0 +1,57 @@
+#include "test.h"
+
+#include <wnlrenderer/seqlock.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace renderer;
+
+namespace {
+// Wider than a word, so a torn copy would mix two stores.
+struct Size {
+    uint64_t width;
+    uint64_t height;
+    uint64_t area;
+};
+};  // namespace
+
+TEST(version_counts_stores) {
+    SeqLock<Size> size{{1, 2, 2}};
+    CHECK(size.version() == 0);
+    CHECK(size.load().area == 2);
+
+    size.store({3, 4, 12});
+    size.store({5, 6, 30});
+    CHECK(size.version() == 2);
+    CHECK(size.load().width == 5);
+}
+
+TEST(readers_never_see_a_torn_value) {
+    SeqLock<Size> size{{0, 1, 0}};
+    std::atomic<bool> done{false};
+    std::thread writer{[&] {
+        for (uint64_t i = 1; i <= 200'000; i++) {
+            size.store({i, i + 1, i * (i + 1)});
+        }
+        done = true;
+    }};
+
+    bool consistent = true;
+    uint64_t last   = 0;
+    while (!done) {
+        auto value = size.load();
+        consistent = consistent && value.height == value.width + 1 &&
+                     value.area == value.width * value.height &&
+                     value.width >= last;
+        last       = value.width;
+    }
+    writer.join();
+    CHECK(consistent);
+    CHECK(size.version() == 200'000);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,114 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/shader_variants.h>
+
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+using namespace renderer;
+using namespace renderer::detail::variant;
+
+namespace {
+auto near(double actual, double expected) -> bool {
+    return std::abs(actual - expected) < 1e-4;
+}
+
+// rgb for 8-bit samples, as the generated shader computes it.
+auto to_rgb(Conversion const& conversion, double y, double u, double v)
+    -> std::array<double, 3> {
+    auto const& m = conversion.matrix;
+    std::array<double, 3> yuv{y / 255.0, u / 255.0, v / 255.0};
+    std::array<double, 3> rgb{};
+    for (size_t row = 0; row < 3; row++) {
+        rgb[row] = m[row] * yuv[0] + m[3 + row] * yuv[1] +
+                   m[6 + row] * yuv[2] + conversion.offset[row];
+    }
+    return rgb;
+}
+
+template <typename Variant>
+auto source_of() -> std::string_view {
+    return Variant::fragment_shader;
+}
+};  // namespace
+
+TEST(conversions_match_the_standards) {
+    auto bt601 = conversion_of(ColorMatrix::bt601, ColorRange::full);
+    CHECK(near(bt601.matrix[0], 1.0));
+    CHECK(near(bt601.matrix[6], 1.402));       // r from v
+    CHECK(near(bt601.matrix[4], -0.344136));   // g from u
+    CHECK(near(bt601.matrix[7], -0.714136));   // g from v
+    CHECK(near(bt601.matrix[5], 1.772));       // b from u
+
+    auto bt709 = conversion_of(ColorMatrix::bt709, ColorRange::limited);
+    CHECK(near(bt709.matrix[0], 1.164384));
+    CHECK(near(bt709.matrix[6], 1.792741));
+    CHECK(near(bt709.matrix[4], -0.213249));
+    CHECK(near(bt709.matrix[7], -0.532909));
+    CHECK(near(bt709.matrix[5], 2.112402));
+}
+
+TEST(offsets_map_black_and_white) {
+    for (auto matrix : {ColorMatrix::bt601, ColorMatrix::bt709}) {
+        auto full = conversion_of(matrix, ColorRange::full);
+        for (auto channel : to_rgb(full, 0.0, 128.0, 128.0)) {
+            CHECK(near(channel, 0.0));
+        }
+        for (auto channel : to_rgb(full, 255.0, 128.0, 128.0)) {
+            CHECK(near(channel, 1.0));
+        }
+
+        auto limited = conversion_of(matrix, ColorRange::limited);
+        for (auto channel : to_rgb(limited, 16.0, 128.0, 128.0)) {
+            CHECK(near(channel, 0.0));
+        }
+        for (auto channel : to_rgb(limited, 235.0, 128.0, 128.0)) {
+            CHECK(near(channel, 1.0));
+        }
+    }
+}
+
+TEST(literals_always_have_a_point) {
+    ConstexprString<64> text;
+    text.append(1.0).append(" ").append(-0.5).append(" ").append(1e-7);
+    CHECK(text.view() == "1.000000 -0.500000 0.000000");
+}
+
+TEST(sources_sample_the_layouts_planes) {
+    auto i420 = source_of<YuvVariant<YuvLayout::I420>>();
+    CHECK(i420.find("uniform sampler2D u_texture_u;") != i420.npos);
+    CHECK(i420.find("uniform sampler2D u_texture_v;") != i420.npos);
+    CHECK(i420.find("u_texture_uv") == i420.npos);
+
+    auto nv12 = source_of<YuvVariant<YuvLayout::NV12>>();
+    CHECK(nv12.find("texture2D(u_texture_uv, flipped_uv).rg)") != nv12.npos);
+    CHECK(nv12.find("u_texture_u;") == nv12.npos);
+
+    auto nv21 = source_of<YuvVariant<YuvLayout::NV21>>();
+    CHECK(nv21.find("texture2D(u_texture_uv, flipped_uv).gr)") != nv21.npos);
+
+    // The coefficients are folded in as literals.
+    CHECK(nv12.find("mat3(1.000000, 1.000000, 1.000000, 0.000000, "
+                    "-0.344136, 1.772000, 1.402000, -0.714136, "
+                    "0.000000)") != nv12.npos);
+    using Bt709 = YuvVariant<YuvLayout::NV12, ColorMatrix::bt709,
+                             ColorRange::limited>;
+    CHECK(source_of<Bt709>().find("mat3(1.164384,") != std::string_view::npos);
+    CHECK(std::strlen(Bt709::fragment_shader) + 1 == Bt709::source.size());
+}
+
+TEST(binding_checks_the_layout) {
+    fake_gl::install();
+    YuvTexture nv12{YuvLayout::NV12, 8, 8, 0};
+    auto bound = fake_gl::counters().textures_bound.load();
+    YuvVariant<YuvLayout::NV12>::bind(nv12);
+    CHECK(fake_gl::counters().textures_bound - bound == 2);
+    CHECK_THROWS(YuvVariant<YuvLayout::I420>::bind(nv12));
+    CHECK_THROWS(YuvVariant<YuvLayout::NV21>::bind(nv12));
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+// Just enough of a harness for assert-style tests: TEST() registers a case,
+// CHECK() records a failure and carries on, main() is run_all().
+namespace test {
+struct Case {
+    char const* name;
+    void (*run)();
+};
+
+inline auto cases() -> std::vector<Case>& {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+inline int failures = 0;
+
+struct Register {
+    Register(char const* name, void (*run)()) {
+        cases().push_back({name, run});
+    }
+};
+
+inline auto fail(char const* file, int line, char const* what) -> void {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    failures++;
+}
+
+inline auto run_all() -> int {
+    for (auto const& test : cases()) {
+        try {
+            test.run();
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "%s: unexpected exception: %s\n", test.name,
+                         e.what());
+            failures++;
+        }
+    }
+    std::fprintf(stderr, "%zu tests, %d failures\n", cases().size(), failures);
+    return failures == 0 ? 0 : 1;
+}
+};  // namespace test
+
+#define TEST(name)                                               \
+    static void name();                                          \
+    static test::Register const name##_registered{#name, &name}; \
+    static void name()
+
+#define CHECK(condition) \
+    ((condition) ? void() : test::fail(__FILE__, __LINE__, #condition))
+
+#define CHECK_THROWS(expression)                                    \
+    do {                                                            \
+        bool thrown = false;                                        \
+        try {                                                       \
+            expression;                                             \
+        } catch (std::exception const&) {                           \
+            thrown = true;                                          \
+        }                                                           \
+        if (!thrown) {                                              \
+            test::fail(__FILE__, __LINE__, "throws: " #expression); \
+        }                                                           \
+    } while (false)
@@ -0,0 +1,47 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/texture_pool.h>
+
+#include <cstddef>
+#include <limits>
+
+using namespace renderer;
+
+TEST(released_textures_are_recycled) {
+    fake_gl::install();
+    TexturePool pool{1 << 20, 1};
+    auto first = pool.acquire<GL_RGBA>(16, 16);
+    auto id    = first->get_id();
+    CHECK(pool.get_stats().live_count == 1);
+    CHECK(pool.get_stats().live_bytes == 16 * 16 * 4 * 2);
+
+    first.reset();
+    CHECK(pool.get_stats().live_count == 0);
+    CHECK(pool.get_stats().idle_count == 1);
+
+    auto second = pool.acquire<GL_RGBA>(16, 16);
+    CHECK(second->get_id() == id);
+    auto other = pool.acquire<GL_RED>(16, 16);
+    CHECK(pool.get_stats().hits == 1);
+    CHECK(pool.get_stats().misses == 2);
+    CHECK(pool.get_stats().live_count == 2);
+
+    second.reset();
+    pool.trim();
+    CHECK(pool.get_stats().idle_count == 0);
+    CHECK(pool.get_stats().evictions == 1);
+}
+
+TEST(textures_that_fail_to_construct_are_not_live) {
+    fake_gl::install();
+    // Too deep a staging ring for its vector to allocate.
+    TexturePool pool{0, std::numeric_limits<size_t>::max() / 2};
+    CHECK_THROWS((void)pool.acquire<GL_RGBA>(16, 16));
+    CHECK(pool.get_stats().live_count == 0);
+    CHECK(pool.get_stats().live_bytes == 0);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,127 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/renderer.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+using namespace renderer;
+
+TEST(region_upload_maps_only_the_region) {
+    fake_gl::install();
+    Texture<GL_RGBA> texture{64, 32};
+    auto frame = texture.begin_upload({8, 4, 16, 8});
+    CHECK(frame.pitch() == 16 * 4);
+    CHECK(frame.size() == 16 * 4 * 8);
+
+    texture.commit(frame, {8, 4, 16, 8});
+    CHECK(texture.get_revision() == 1);
+    CHECK_THROWS((void)texture.begin_upload({60, 0, 8, 8}));
+}
+
+TEST(bad_commit_keeps_the_frame_mapped) {
+    fake_gl::install();
+    Texture<GL_RGBA> texture{64, 32};
+    auto frame = texture.begin_upload({0, 0, 16, 8});
+
+    CHECK_THROWS(texture.commit(frame, {56, 0, 16, 8}));  // outside
+    CHECK_THROWS(texture.commit(frame, {0, 0, 16, 16}));  // frame too small
+    CHECK_THROWS(texture.commit(frame, {0, 0, 32, 8}));   // pitch too small
+    CHECK(texture.get_revision() == 0);
+
+    texture.commit(frame, {0, 0, 16, 8});
+    CHECK(texture.get_revision() == 1);
+    CHECK_THROWS(texture.commit(frame, {0, 0, 16, 8}));  // already unmapped
+}
+
+TEST(copy_data_region_checks_its_input) {
+    fake_gl::install();
+    Texture<GL_RGB> texture{16, 16};
+    std::vector<std::byte> pixels(4 * 3 * 4);
+    texture.copy_data_region({2, 2, 4, 4}, pixels);
+    CHECK(texture.get_revision() == 1);
+
+    CHECK_THROWS(texture.copy_data_region({2, 2, 4, 5}, pixels));
+    CHECK_THROWS(texture.copy_data_region({14, 2, 4, 4}, pixels));
+    CHECK_THROWS(texture.copy_data_region({0, 0, 0, 4}, pixels));
+
+    // Nothing was left mapped by the failures.
+    texture.copy_data_region({0, 0, 4, 4}, pixels);
+    CHECK(texture.get_revision() == 2);
+}
+
+TEST(texture_array_layers_are_checked) {
+    fake_gl::install();
+    TextureArray<GL_RGBA> array{8, 8, 2};
+    auto first  = array.acquire_layer();
+    auto second = array.acquire_layer();
+    CHECK(first != second);
+    CHECK_THROWS(array.acquire_layer());
+
+    array.release_layer(first);
+    CHECK_THROWS(array.release_layer(first));
+    CHECK_THROWS(array.release_layer(2));
+    CHECK_THROWS(array.release_layer(-1));
+    CHECK(array.acquire_layer() == first);
+
+    auto frame = array.begin_upload();
+    CHECK_THROWS(array.commit(frame, 2));
+    array.commit(frame, second);
+    CHECK(array.get_revision() == 1);
+
+    std::vector<std::byte> pixels(8 * 8 * 4);
+    CHECK_THROWS(array.copy_data(5, pixels, 0));
+    array.copy_data(first, pixels, 0);
+    CHECK(array.get_revision() == 2);
+}
+
+TEST(yuv_uploads_are_checked_before_unmapping) {
+    fake_gl::install();
+    YuvTexture texture{YuvLayout::NV12, 16, 8};
+    CHECK_THROWS((void)texture.begin_upload(8));  // narrower than a row
+
+    auto frame = texture.begin_upload();
+    UploadFrame truncated{frame.span().first(16 * 8), frame.pitch()};
+    CHECK_THROWS(texture.commit(truncated));
+    CHECK(texture.get_revision() == 0);
+
+    // Still mapped, so the whole frame can be committed.
+    texture.commit(frame);
+    CHECK(texture.get_revision() == 1);
+
+    std::vector<std::byte> pixels(texture.frame_size(8));
+    CHECK_THROWS(texture.copy_data(pixels, 8));
+    CHECK_THROWS(texture.copy_data(std::span{pixels}.first(16), 16));
+
+    // Nothing was left mapped by the failures.
+    pixels.resize(texture.frame_size(16));
+    texture.copy_data(pixels, 16);
+    CHECK(texture.get_revision() == 2);
+}
+
+TEST(dropped_frames_are_unmapped) {
+    fake_gl::install();
+    Texture<GL_RGBA> texture{16, 16};
+    {
+        auto frame = texture.begin_upload();
+        CHECK_THROWS((void)texture.begin_upload());
+    }
+    auto frame = texture.begin_upload();
+    auto moved = std::move(frame);
+    texture.commit(moved);
+    CHECK(texture.get_revision() == 1);
+
+    // Dropping a committed frame leaves the next mapping alone.
+    auto next = texture.begin_upload();
+    {
+        auto stale = std::move(moved);
+    }
+    texture.commit(next);
+    CHECK(texture.get_revision() == 2);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,102 @@
+#include "fake_gl.h"
+#include "test.h"
+
+#include <wnlrenderer/upload_worker.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+using namespace renderer;
+
+namespace {
+auto no_context() -> int {
+    return 0;
+}
+};  // namespace
+
+TEST(fence_waits_repeatedly_from_every_copy) {
+    fake_gl::install();
+    auto deleted = fake_gl::counters().fences_deleted.load();
+    auto waited  = fake_gl::counters().fences_waited.load();
+    {
+        std::optional<UploadFence> copy;
+        {
+            UploadWorker worker{&no_context};
+            auto fence = worker.submit([] {});
+            CHECK(fence.wait());
+            CHECK(fence.get_status() == UploadStatus::complete);
+            CHECK(fence.wait());
+            copy = fence;
+        }
+        CHECK(copy->ready());
+        std::thread other{[&] { copy->wait(); }};
+        other.join();
+        CHECK(fake_gl::counters().fences_waited == waited + 3);
+        CHECK(fake_gl::counters().fences_deleted == deleted);
+    }
+    CHECK(fake_gl::counters().fences_deleted == deleted + 1);
+}
+
+TEST(waiting_rebinds_what_the_job_wrote) {
+    fake_gl::install();
+    gl_state().reset();
+    gl_state().bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, 5);
+    UploadWorker worker{&no_context};
+    auto fence = worker.submit([] {});
+    CHECK(fence.wait());
+
+    // Bound before the worker wrote it; only a new bind is sure to see that.
+    auto bound = fake_gl::counters().textures_bound.load();
+    gl_state().bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, 5);
+    CHECK(fake_gl::counters().textures_bound == bound + 1);
+}
+
+TEST(fences_complete_in_submission_order) {
+    fake_gl::install();
+    std::atomic<int> ran{0};
+    UploadWorker worker{&no_context};
+    auto first  = worker.submit([&] { CHECK(ran++ == 0); });
+    auto second = worker.submit([&] { CHECK(ran++ == 1); });
+    second.wait();
+    CHECK(first.ready());
+    CHECK(ran == 2);
+}
+
+TEST(throwing_job_fails_its_fence) {
+    fake_gl::install();
+    UploadWorker worker{&no_context};
+    auto failed = worker.submit([] { throw std::runtime_error("lost"); });
+    CHECK_THROWS(failed.wait());
+    CHECK(failed.get_status() == UploadStatus::failed);
+    CHECK_THROWS(failed.wait());
+
+    // The worker carries on with the next job.
+    CHECK(worker.submit([] {}).wait());
+}
+
+TEST(shutdown_cancels_queued_jobs) {
+    fake_gl::install();
+    std::atomic<bool> release{false};
+    auto worker  = std::make_unique<UploadWorker>(&no_context);
+    auto running = worker->submit([&] { release.wait(false); });
+    auto queued  = worker->submit([] {});
+
+    // The destructor stops the worker while the first job still runs.
+    std::thread shutdown{[&] { worker.reset(); }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release = true;
+    release.notify_all();
+    shutdown.join();
+
+    CHECK(running.wait());
+    CHECK(!queued.wait());
+    CHECK(queued.get_status() == UploadStatus::cancelled);
+}
+
+int main() {
+    return test::run_all();
+}